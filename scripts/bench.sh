@@ -0,0 +1,225 @@
+#!/usr/bin/env bash
+
+# Benchmark the tools on fixed synthetic corpora and compare against a stored baseline.
+#
+# Usage: bench.sh BIN_DIR BASELINE_JSON [--save]
+#
+# Writes bench.json to the current directory, one result per line.
+# Every run is repeated BENCH_RUNS times (default 3), the fastest time of each result is kept.
+# The full revdgst runs are timed for each of BENCH_THREADS (default 1 2 4 ... up to the CPU count).
+# With --save the results also replace the baseline.
+# Results more than BENCH_TOLERANCE percent (default 10) slower than the baseline are reported,
+# and the script exits non-zero if there are any.
+#
+# Copyright (C) 2019 Christian W. Zuckschwerdt <zany@triq.net>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+
+set -e
+
+bin_dir=${1:?missing BIN_DIR}
+baseline=${2:?missing BASELINE_JSON}
+save=$3
+tolerance=${BENCH_TOLERANCE:-10}
+runs=${BENCH_RUNS:-3}
+corpora=bench-corpora
+results=bench.json
+
+nproc=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+thread_counts=$BENCH_THREADS
+if [ -z "$thread_counts" ]; then
+    for ((t = 1; t <= nproc; t *= 2)); do
+        thread_counts+=" $t"
+    done
+fi
+
+# Write a corpus of COUNT random codes of LEN bytes (including the checksum byte) seeded with SEED.
+# Park-Miller LCG, the products stay exact in awk's doubles, so the corpora are the same everywhere.
+gen_corpus() {
+    awk -v count="$1" -v len="$2" -v seed="$3" 'BEGIN {
+        x = seed
+        printf "# synthetic corpus of %d codes of %d bytes, seed %d\n", count, len, seed
+        for (i = 0; i < count; ++i) {
+            line = ""
+            for (j = 0; j < len; ++j) {
+                x = (x * 16807) % 2147483647
+                line = line sprintf("%02x", x % 256)
+            }
+            print line
+        }
+    }' >"$corpora/$4.txt"
+}
+
+# every key is scored on about half the codes before it is given up,
+# the revdgst kernels get corpora large enough for each to take about 0.2 s or more
+mkdir -p "$corpora"
+gen_corpus 32 6 1 n32_len6
+gen_corpus 1024 6 6 n1024_len6
+gen_corpus 1024 10 2 n1024_len10
+gen_corpus 4096 6 7 n4096_len6
+gen_corpus 4096 10 8 n4096_len10
+gen_corpus 65536 6 9 n65536_len6
+gen_corpus 65536 10 10 n65536_len10
+gen_corpus 16 8 3 n16_len8
+gen_corpus 32 8 4 n32_len8
+gen_corpus 4096 12 5 n4096_len12
+gen_corpus 8192 12 11 n8192_len12
+
+names=()
+declare -A best_seconds best_rate
+
+# Record NAME SECONDS [CANDIDATES_PER_SEC], keeping the fastest of the repeated runs.
+record() {
+    if [ -z "${best_seconds[$1]}" ]; then
+        names+=("$1")
+    elif awk -v old="${best_seconds[$1]}" -v new="$2" 'BEGIN { exit !(new >= old) }'; then
+        return
+    fi
+    best_seconds[$1]=$2
+    best_rate[$1]=$3
+}
+
+# Run a tool, record its total run time and candidates per second if it counts candidates.
+# Sets $out to the stdout of the run.
+run() {
+    local name=$1
+    shift
+    local err
+    err=$(mktemp)
+    out=$("$@" 2>"$err")
+    local seconds rate
+    seconds=$(printf "%s\n" "$out" | sed -n 's/^Run time: .* \([0-9.]*\) total$/\1/p' | tail -1)
+    rate=$(sed -n 's/^Progress: done .*, \([0-9.e+]*\) candidates\/s$/\1/p' "$err" | tail -1)
+    rm -f "$err"
+    record "$name" "${seconds:-0}" "$rate"
+}
+
+# Run the revdgst code paths of the ALGOS (e.g. Galois Rev-Galois) on one thread REPS times,
+# record the time of each code path summed over the repeats.
+kernels() {
+    local corpus=$1
+    local reps=$2
+    shift 2
+    local args=()
+    local algo reflect
+    for algo in "$@"; do
+        for reflect in "" " BYTE_REFLECT" " BIT_REFLECT" " BIT_REFLECT BYTE_REFLECT"; do
+            args+=(--variant "$algo$reflect")
+        done
+    done
+
+    local -A sums=()
+    local labels=()
+    local seconds label
+    for ((k = 0; k < reps; ++k)); do
+        out=$("$bin_dir/revdgst" -p 1 "${args[@]}" "$corpora/$corpus.txt" 2>/dev/null)
+        while read -r seconds label; do
+            [ -z "${sums[$label]}" ] && labels+=("$label")
+            sums[$label]=$(awk -v a="${sums[$label]:-0}" -v b="$seconds" 'BEGIN { printf "%.3f", a + b }')
+        done < <(printf "%s\n" "$out" | sed -n 's/^Time elapsed in s: \([0-9.]*\) for: \(.*\)$/\1 \2/p')
+    done
+    for label in "${labels[@]}"; do
+        record "revdgst/$corpus/kernel/$label" "${sums[$label]}"
+    done
+}
+
+# One run of every benchmark.
+bench_once() {
+    # revdgst, the time of each kernel on one thread
+    kernels n4096_len6 2 Galois Rev-Galois Fibonacci Rev-Fibonacci
+    kernels n4096_len10 1 Galois Rev-Galois Fibonacci Rev-Fibonacci
+    kernels n65536_len6 3 Fletcher Rev-Fletcher
+    kernels n65536_len10 2 Fletcher Rev-Fletcher
+    kernels n1024_len6 1 Shift16 Rev-Shift16
+    kernels n1024_len10 1 Shift16 Rev-Shift16
+
+    # revdgst, all code paths for each thread count
+    for corpus in n1024_len6 n1024_len10; do
+        for threads in $thread_counts; do
+            run "revdgst/$corpus/p$threads" "$bin_dir/revdgst" --progress 0 -p "$threads" "$corpora/$corpus.txt"
+        done
+    done
+
+    # revdgst16, a shard of each mode to keep the runs short
+    run "revdgst16/n16_len8/solver/shard1of1024" "$bin_dir/revdgst16" --progress 0 -p "$nproc" -a -l --shard 1/1024 "$corpora/n16_len8.txt"
+    run "revdgst16/n16_len8/gray/shard1of256" "$bin_dir/revdgst16" --progress 0 -p "$nproc" -a -g --shard 1/256 "$corpora/n16_len8.txt"
+    run "revdgst16/n16_len8/brute/shard1of1024" "$bin_dir/revdgst16" --progress 0 -p "$nproc" -a --shard 1/1024 "$corpora/n16_len8.txt"
+
+    # revsum scans
+    for corpus in n32_len6 n32_len8; do
+        run "revsum/$corpus" "$bin_dir/revsum" "$corpora/$corpus.txt"
+    done
+
+    # bitbrk modes, the collisions are quadratic in the codes
+    run "bitbrk/n4096_len12/bits" "$bin_dir/bitbrk" -b 8 "$corpora/n4096_len12.txt"
+    run "bitbrk/n8192_len12/collisions" "$bin_dir/bitbrk" -c "$corpora/n8192_len12.txt"
+    run "bitbrk/n4096_len12/keybreak" "$bin_dir/bitbrk" -k "$corpora/n4096_len12.txt"
+}
+
+for ((r = 1; r <= runs; ++r)); do
+    echo "Run $r of $runs..."
+    bench_once
+done
+
+{
+    echo "{\"nproc\": $nproc, \"runs\": $runs, \"threads\": \"${thread_counts# }\", \"results\": ["
+    for ((i = 0; i < ${#names[@]}; ++i)); do
+        name=${names[$i]}
+        sep=","
+        [ "$i" -eq $((${#names[@]} - 1)) ] && sep=""
+        if [ -n "${best_rate[$name]}" ]; then
+            echo "  {\"name\": \"$name\", \"seconds\": ${best_seconds[$name]}, \"candidates_per_sec\": ${best_rate[$name]}}$sep"
+        else
+            echo "  {\"name\": \"$name\", \"seconds\": ${best_seconds[$name]}}$sep"
+        fi
+    done
+    echo "]}"
+} >"$results"
+for name in "${names[@]}"; do
+    printf "%-64s %10.3f s %14s\n" "$name" "${best_seconds[$name]}" "${best_rate[$name]:+${best_rate[$name]} cand/s}"
+done
+echo "Results written to $results"
+
+if [ "$save" = "--save" ]; then
+    cp "$results" "$baseline"
+    echo "Baseline saved to $baseline"
+    exit 0
+fi
+
+if [ ! -f "$baseline" ]; then
+    echo "No baseline at $baseline, run the bench-baseline target to save one."
+    exit 0
+fi
+
+# compare the seconds of each result by name, relative to the baseline
+awk -v tolerance="$tolerance" '
+    function field(line, key,    m) {
+        if (match(line, "\"" key "\": [^,}]*")) {
+            m = substr(line, RSTART, RLENGTH)
+            sub(/^[^:]*: /, "", m)
+            gsub(/"/, "", m)
+            return m
+        }
+        return ""
+    }
+    FNR == NR { if ((n = field($0, "name")) != "") base[n] = field($0, "seconds"); next }
+    (n = field($0, "name")) != "" && n in base {
+        old = base[n] + 0
+        new = field($0, "seconds") + 0
+        pct = old > 0 ? 100.0 * (new - old) / old : 0
+        flag = pct > tolerance ? "  SLOWER" : pct < -tolerance ? "  faster" : ""
+        printf "%-64s %8.3f -> %8.3f s %+7.1f %%%s\n", n, old, new, pct, flag
+        if (pct > tolerance)
+            regressions++
+    }
+    END {
+        if (regressions) {
+            printf "%d results slower than the baseline by more than %d %%\n", regressions, tolerance
+            exit 1
+        }
+        print "No regressions against the baseline."
+    }
+' "$baseline" "$results"
@@ -19,6 +19,7 @@
 #include "codes.h"
 
 static struct data data[LIST_MAX];
+static struct msg_matrix msgs;
 static unsigned msg_len  = 0;
 static unsigned list_len = 0;
 
@@ -30,8 +31,8 @@ static void single_bits(void)
 
     for (unsigned k = 0; k < msg_len * 8; ++k) {
         for (unsigned i = 0; i < list_len; ++i) {
-            uint8_t const *codei = data[i].d;
-            uint8_t chki   = data[i].chk;
+            uint8_t const *codei = msgs.d[i];
+            uint8_t chki   = msgs.chk[i];
 
             uint8_t codex[MSG_MAX];
             memcpy(codex, codei, msg_len);
@@ -41,8 +42,8 @@ static void single_bits(void)
             //uint8_t nibble = 1 << (k & 3); // MOD 4
 
             for (unsigned j = i + 1; j < list_len; ++j) {
-                uint8_t const *codej = data[j].d;
-                uint8_t chkj     = data[j].chk;
+                uint8_t const *codej = msgs.d[j];
+                uint8_t chkj     = msgs.chk[j];
 
                 if (!memcmp(codex, codej, msg_len)) {
                     sprint_code(bufi, &data[i], msg_len);
@@ -64,16 +65,16 @@ static void n_bits(unsigned bits)
     printf("k : codei  chki  ->  codej  chkj  |  chki^chkj chki+chkj chki-chkj\n");
 
     for (unsigned i = 0; i < list_len; ++i) {
-        uint8_t const *codei = data[i].d;
-        uint8_t chki   = data[i].chk;
+        uint8_t const *codei = msgs.d[i];
+        uint8_t chki   = msgs.chk[i];
 
         for (unsigned j = i + 1; j < list_len; ++j) {
-            uint8_t const *codej = data[j].d;
-            uint8_t chkj   = data[j].chk;
+            uint8_t const *codej = msgs.d[j];
+            uint8_t chkj   = msgs.chk[j];
 
             unsigned pop = 0;
             struct data datax;
-            for (unsigned k = 0; k < msg_len; ++k) {
+            for (unsigned k = 0; k < msg_len && k < MSG_MAX; ++k) {
                 datax.d[k] = codei[k] ^ codej[k];
                 pop += popcount(datax.d[k]);
             }
@@ -97,10 +98,10 @@ static void all_collisions(void)
     printf("codei  chki  ->  codej  chkj\n");
 
     for (unsigned i = 0; i < list_len; ++i) {
-        uint8_t chki = data[i].chk;
+        uint8_t chki = msgs.chk[i];
 
         for (unsigned j = i + 1; j < list_len; ++j) {
-            uint8_t chkj = data[j].chk;
+            uint8_t chkj = msgs.chk[j];
 
             if (chki == chkj) {
                 sprint_code(bufi, &data[i], msg_len);
@@ -130,16 +131,16 @@ static void key_brk(void)
             unsigned hit_count = 0;
 
             for (unsigned i = 0; i < list_len; ++i) {
-                uint8_t const *codei = data[i].d;
-                uint8_t chki   = data[i].chk;
+                uint8_t const *codei = msgs.d[i];
+                uint8_t chki   = msgs.chk[i];
 
                 uint8_t codex[MSG_MAX];
                 memcpy(codex, codei, msg_len);
                 codex[k / 8] ^= 1 << (7 - k % 8); // MSB to LSB
 
                 for (unsigned j = i + 1; j < list_len; ++j) {
-                    uint8_t const *codej = data[j].d;
-                    uint8_t chkj   = data[j].chk;
+                    uint8_t const *codej = msgs.d[j];
+                    uint8_t chkj   = msgs.chk[j];
 
                     if (!memcmp(codex, codej, msg_len)) {
                         // printf("%2d : %d(%02x)  ^  %d(%02x)  =  %02x\n",
@@ -169,15 +170,19 @@ static void key_brk(void)
         for (unsigned i = 0; i < list_len; ++i) {
             for (unsigned k = 0; k < bit_len; ++k) {
                 uint8_t bit = 1 << (7 - (k % 8)); // msb to lsb
-                if (keystream[k] >= 0 && data[i].d[k / 8] & bit) {
-                    data[i].d[k / 8] ^= bit;
-                    data[i].d[msg_len] ^= keystream[k];
-                    data[i].chk ^= keystream[k];
+                if (keystream[k] >= 0 && msgs.d[i][k / 8] & bit) {
+                    msgs.d[i][k / 8] ^= bit;
+                    msgs.d[i][msg_len] ^= keystream[k];
+                    msgs.chk[i] ^= keystream[k];
                 }
             }
         }
     }
 
+    // copy the remaining bits back for printing
+    for (unsigned i = 0; i < list_len; ++i) {
+        memcpy(data[i].d, msgs.d[i], MSG_MAX);
+    }
     printf("; remaining data bits\n");
     print_codes(data, msg_len + 1, list_len);
 
@@ -247,6 +252,8 @@ int main(int argc, char const *argv[])
 
     if (verbose)
         fprintf(stderr, "Processing...\n");
+    if (msg_matrix_init(&msgs, data, msg_len, list_len) < 0)
+        exit(1);
     msg_len -= 1; // use 8-bit chk
 
     if (collisions)
@@ -258,5 +265,7 @@ int main(int argc, char const *argv[])
     else
         single_bits();
 
+    msg_matrix_free(&msgs);
+
     print_runtimes();
 }
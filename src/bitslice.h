@@ -0,0 +1,145 @@
+/** @file
+    bitslice.h: bit-sliced arithmetic on 256 lanes.
+
+    Copyright (C) 2019 Christian W. Zuckschwerdt <zany@triq.net>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_BITSLICE_H_
+#define INCLUDE_BITSLICE_H_
+
+#include <stdint.h>
+
+/*
+A value of n bits for every lane is stored as n bit-planes, plane j holds bit j of all lanes.
+Lane k is bit (k % 64) of element (k / 64).
+With AVX2 (or better) enabled a plane is a single register, otherwise the compiler splits the vector.
+*/
+
+#define SLICE_LANES 256
+
+typedef uint64_t slice_t __attribute__((vector_size(32)));
+
+/// All lanes set to the given bit.
+__attribute__((always_inline))
+static inline slice_t slice_set(unsigned bit)
+{
+    slice_t zero = {0};
+    return zero - (uint64_t)(bit & 1);
+}
+
+/// Plane j of the lane index, i.e. lane k holds bit j of k.
+__attribute__((always_inline))
+static inline slice_t slice_index(unsigned j)
+{
+    static uint64_t const pattern[6] = {
+            0xaaaaaaaaaaaaaaaa,
+            0xcccccccccccccccc,
+            0xf0f0f0f0f0f0f0f0,
+            0xff00ff00ff00ff00,
+            0xffff0000ffff0000,
+            0xffffffff00000000,
+    };
+    if (j < 6)
+        return (slice_t){pattern[j], pattern[j], pattern[j], pattern[j]};
+    else if (j == 6)
+        return (slice_t){0, ~0ULL, 0, ~0ULL};
+    else
+        return (slice_t){0, 0, ~0ULL, ~0ULL};
+}
+
+__attribute__((always_inline))
+static inline int slice_any(slice_t x)
+{
+    return (x[0] | x[1] | x[2] | x[3]) != 0;
+}
+
+__attribute__((always_inline))
+static inline unsigned slice_lane(slice_t x, unsigned k)
+{
+    return (x[k >> 6] >> (k & 63)) & 1;
+}
+
+/// Gather the value of lane k from width planes.
+__attribute__((always_inline))
+static inline unsigned slice_value(slice_t const *x, unsigned k, unsigned width)
+{
+    unsigned v = 0;
+    for (unsigned j = 0; j < width; ++j) {
+        v |= slice_lane(x[j], k) << j;
+    }
+    return v;
+}
+
+/// acc += x, modulo 2^width.
+__attribute__((always_inline))
+static inline void slice_add(slice_t *acc, slice_t const *x, unsigned width)
+{
+    slice_t carry = {0};
+    for (unsigned j = 0; j < width; ++j) {
+        slice_t t = acc[j] ^ x[j];
+        slice_t c = (acc[j] & x[j]) | (t & carry);
+        acc[j]    = t ^ carry;
+        carry     = c;
+    }
+}
+
+/// res = a - b, modulo 2^width.
+__attribute__((always_inline))
+static inline void slice_sub(slice_t *res, slice_t const *a, slice_t const *b, unsigned width)
+{
+    slice_t borrow = {0};
+    for (unsigned j = 0; j < width; ++j) {
+        slice_t d = a[j] ^ b[j];
+        slice_t n = (~a[j] & b[j]) | (~d & borrow);
+        res[j]    = d ^ borrow;
+        borrow    = n;
+    }
+}
+
+/// Mask of the lanes that equal the constant c.
+__attribute__((always_inline))
+static inline slice_t slice_eq(slice_t const *x, unsigned c, unsigned width)
+{
+    slice_t r = slice_set(1);
+    for (unsigned j = 0; j < width; ++j) {
+        r &= ((c >> j) & 1) ? x[j] : ~x[j];
+    }
+    return r;
+}
+
+/// Increment the counter of the lanes in mask.
+__attribute__((always_inline))
+static inline void slice_inc(slice_t *cnt, slice_t mask, unsigned width)
+{
+    slice_t carry = mask;
+    for (unsigned j = 0; j < width; ++j) {
+        slice_t t = cnt[j] & carry;
+        cnt[j] ^= carry;
+        carry = t;
+    }
+}
+
+/// Mask of the lanes that are greater or equal to the constant c.
+__attribute__((always_inline))
+static inline slice_t slice_ge(slice_t const *cnt, unsigned c, unsigned width)
+{
+    slice_t lt = {0};
+    slice_t eq = slice_set(1);
+    for (int j = width - 1; j >= 0; --j) {
+        if ((c >> j) & 1) {
+            lt |= eq & ~cnt[j];
+            eq &= cnt[j];
+        }
+        else {
+            eq &= ~cnt[j];
+        }
+    }
+    return ~lt;
+}
+
+#endif /* INCLUDE_BITSLICE_H_ */
@@ -0,0 +1,200 @@
+/** @file
+    checkpoint.h: record finished jobs and results to resume an interrupted search.
+
+    Copyright (C) 2019 Christian W. Zuckschwerdt <zany@triq.net>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_CHECKPOINT_H_
+#define INCLUDE_CHECKPOINT_H_
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "job.h"
+#include "result.h"
+
+/*
+A checkpoint file is appended to as the search goes on: a header line that identifies the search,
+then for every finished job a "tile N" line, preceded by a "job N" line and the results (see result.h)
+if the job found any.
+A job's results are held back until the job is finished and then written and synced in one go,
+i.e. a few hundred writes for a search of hours.
+
+On resume the header needs to match, finished jobs are skipped, and their results are passed back.
+Results that are not enclosed by "job N" and "tile N" lines of the same job are ignored,
+as is a line cut short by an interruption, their job will simply run again.
+*/
+
+static FILE *checkpoint_fp;
+static unsigned char *checkpoint_tiles;
+static int checkpoint_count;
+static pthread_mutex_t checkpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the results of the job running on this thread
+static _Thread_local struct result *checkpoint_pending;
+static _Thread_local unsigned checkpoint_pending_len;
+static _Thread_local unsigned checkpoint_pending_cap;
+
+static int checkpoint_read(char const *filename, char const *header, void (*on_result)(struct result const *r))
+{
+    FILE *fp = fopen(filename, "r");
+    if (!fp)
+        return 0; // nothing to resume
+
+    int partial = 0;
+    int lines   = 0;
+    char line[256];
+    // result lines are only passed back once the "tile N" line that follows them was read
+    int held_job      = -1;
+    char **held       = NULL;
+    unsigned held_len = 0;
+    unsigned held_cap = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strlen(line);
+        partial    = !len || line[len - 1] != '\n';
+        if (partial)
+            break; // interrupted while writing, must be the last line
+        line[len - 1] = '\0';
+
+        if (!lines++) {
+            if (strncmp(line, "# ", 2) || strcmp(line + 2, header)) {
+                fprintf(stderr, "Checkpoint %s is from a different search:\n%s\n", filename, line);
+                fclose(fp);
+                return -1;
+            }
+            continue;
+        }
+
+        int tile;
+        struct result r;
+        if (sscanf(line, "tile %d", &tile) == 1) {
+            if (tile >= 0 && tile < checkpoint_count)
+                checkpoint_tiles[tile] = 1;
+            for (unsigned i = 0; i < held_len; ++i) {
+                if (held_job == tile && !result_parse(held[i], &r))
+                    on_result(&r);
+                free(held[i]);
+            }
+            held_len = 0;
+            held_job = -1;
+        }
+        else if (sscanf(line, "job %d", &tile) == 1) {
+            for (unsigned i = 0; i < held_len; ++i)
+                free(held[i]); // results of an unfinished job
+            held_len = 0;
+            held_job = tile;
+        }
+        else {
+            if (held_len >= held_cap) {
+                held_cap = held_cap ? held_cap * 2 : 64;
+                held     = realloc(held, held_cap * sizeof(*held));
+            }
+            if (!held || !(held[held_len++] = strdup(line))) {
+                perror("checkpoint_read");
+                exit(1);
+            }
+        }
+    }
+    fclose(fp);
+    for (unsigned i = 0; i < held_len; ++i)
+        free(held[i]); // results of an unfinished job
+    free(held);
+    return lines ? 1 + partial : 0;
+}
+
+/// Open a checkpoint for a search of @p count jobs, optionally resuming it. Returns 0 on success.
+static int checkpoint_open(char const *filename, char const *header, int count, int resume, void (*on_result)(struct result const *r))
+{
+    checkpoint_count = count;
+    checkpoint_tiles = calloc(count, 1);
+    if (!checkpoint_tiles) {
+        perror("checkpoint_open calloc");
+        return -1;
+    }
+
+    int ret = resume ? checkpoint_read(filename, header, on_result) : 0;
+    if (ret < 0)
+        return -1;
+
+    checkpoint_fp = fopen(filename, ret ? "a" : "w");
+    if (!checkpoint_fp) {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return -1;
+    }
+    if (!ret)
+        fprintf(checkpoint_fp, "# %s\n", header);
+    else if (ret > 1)
+        fprintf(checkpoint_fp, "\n"); // terminate the interrupted line
+    fflush(checkpoint_fp);
+
+    if (ret) {
+        int done = 0;
+        for (int i = job_shard_index; i < count; i += job_shard_count)
+            done += checkpoint_tiles[i];
+        fprintf(stderr, "Resuming %s with %d of %d jobs done.\n", filename, done, job_shard_jobs(count));
+    }
+    return 0;
+}
+
+/// Check if a job was finished by a previous run.
+static int checkpoint_done(int tile)
+{
+    return checkpoint_tiles && tile >= 0 && tile < checkpoint_count && checkpoint_tiles[tile];
+}
+
+static void checkpoint_sync(void)
+{
+    fflush(checkpoint_fp);
+    fsync(fileno(checkpoint_fp));
+}
+
+/// Record a finished job, together with the results it found.
+static void checkpoint_tile(int tile)
+{
+    if (!checkpoint_fp)
+        return;
+    pthread_mutex_lock(&checkpoint_lock);
+    if (checkpoint_pending_len)
+        fprintf(checkpoint_fp, "job %d\n", tile);
+    for (unsigned i = 0; i < checkpoint_pending_len; ++i)
+        result_print(checkpoint_fp, &checkpoint_pending[i]);
+    fprintf(checkpoint_fp, "tile %d\n", tile);
+    checkpoint_sync();
+    pthread_mutex_unlock(&checkpoint_lock);
+    checkpoint_pending_len = 0;
+}
+
+/// Drop the results of a job that did not finish, it will run again on resume.
+static void checkpoint_discard(void)
+{
+    checkpoint_pending_len = 0;
+}
+
+/// Hold a result of the running job until checkpoint_tile() records the job.
+static void checkpoint_result(struct result const *r)
+{
+    if (!checkpoint_fp)
+        return;
+    result_grow(&checkpoint_pending, &checkpoint_pending_cap, checkpoint_pending_len);
+    checkpoint_pending[checkpoint_pending_len++] = *r;
+}
+
+static void checkpoint_close(void)
+{
+    if (checkpoint_fp)
+        fclose(checkpoint_fp);
+    checkpoint_fp = NULL;
+    free(checkpoint_tiles);
+    checkpoint_tiles = NULL;
+}
+
+#endif /* INCLUDE_CHECKPOINT_H_ */
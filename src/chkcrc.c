@@ -75,13 +75,20 @@ int main(int argc, char const *argv[])
     if (verbose)
         print_codes(data, msg_len, list_len);
 
+    uint16_t table16[4][256];
+    uint8_t table8[8][256];
+    if (poly > 255)
+        crc16_slice_init(table16, poly);
+    else
+        crc8_slice_init(table8, poly);
+
     for (unsigned j = 0; j < list_len; ++j) {
         struct data *d = &data[j];
         int chk;
         if (poly > 255)
-            chk = crc16(d->d, msg_len, poly, init);
+            chk = crc16_slice4(d->d, msg_len, table16, init);
         else
-            chk = crc8(d->d, msg_len, poly, init);
+            chk = crc8_slice8(d->d, msg_len, table8, init);
 
         if (chk != fxor) {
             if (d->comment)
@@ -250,3 +250,51 @@ void free_codes(struct data *data, unsigned list_len)
         data++;
     }
 }
+
+// round up to a multiple of the alignment, as required by aligned_alloc()
+static size_t msg_align_size(size_t size)
+{
+    return (size + MSG_ALIGN - 1) / MSG_ALIGN * MSG_ALIGN;
+}
+
+int msg_matrix_init(struct msg_matrix *m, struct data const *data, unsigned msg_len, unsigned list_len)
+{
+    m->msg_len  = msg_len;
+    m->list_len = list_len;
+    m->d        = aligned_alloc(MSG_ALIGN, msg_align_size(list_len * sizeof(*m->d)));
+    m->chk      = aligned_alloc(MSG_ALIGN, msg_align_size(list_len * sizeof(*m->chk)));
+    m->chk16    = aligned_alloc(MSG_ALIGN, msg_align_size(list_len * sizeof(*m->chk16)));
+    if (!m->d || !m->chk || !m->chk16) {
+        fprintf(stderr, "Failed to allocate the message matrix.\n");
+        msg_matrix_free(m);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < list_len; ++i) {
+        memset(m->d[i], 0, MSG_STRIDE);
+        memcpy(m->d[i], data[i].d, MSG_MAX);
+        m->chk[i]   = data[i].chk;
+        m->chk16[i] = data[i].chk16;
+    }
+    return (int)list_len;
+}
+
+void msg_matrix_free(struct msg_matrix *m)
+{
+    free(m->d);
+    free(m->chk);
+    free(m->chk16);
+    m->d     = NULL;
+    m->chk   = NULL;
+    m->chk16 = NULL;
+}
+
+uint32_t msg_matrix_hash(struct msg_matrix const *m)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned i = 0; i < m->list_len; ++i) {
+        for (unsigned b = 0; b < m->msg_len; ++b)
+            hash = (hash ^ m->d[i][b]) * 16777619u;
+    }
+    return hash;
+}
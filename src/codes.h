@@ -20,6 +20,16 @@
 #define MSG_MAX 19
 #define LIST_MAX 65536
 
+/// Expand X(len) for the common message lengths without the checksum, to specialize kernels on the length.
+/// Other lengths use a generic kernel, specializing all of them takes too long to compile.
+#define MSG_LEN_COMMON(X) \
+        X(3) \
+        X(4) \
+        X(5) \
+        X(6) \
+        X(7) \
+        X(8)
+
 struct data {
     uint8_t d[MSG_MAX];
     uint8_t chk;
@@ -35,6 +45,19 @@ struct data_list {
     char *header;
 };
 
+/// Packed message matrix for the hot loops, payload rows at a fixed stride and the checksums in separate arrays.
+/// Rows are zero padded and the matrix is cache line aligned.
+#define MSG_STRIDE 32
+#define MSG_ALIGN 64
+
+struct msg_matrix {
+    uint8_t (*d)[MSG_STRIDE];
+    uint8_t *chk;
+    uint16_t *chk16;
+    unsigned msg_len;
+    unsigned list_len;
+};
+
 int parse_code(char const *text, struct data *data);
 
 int read_codes(char const *filename, struct data *data, unsigned *msg_len, unsigned msg_max, unsigned list_max);
@@ -45,4 +68,11 @@ void print_codes(struct data const *data, unsigned msg_len, unsigned list_len);
 
 void free_codes(struct data *data, unsigned list_len);
 
+int msg_matrix_init(struct msg_matrix *m, struct data const *data, unsigned msg_len, unsigned list_len);
+
+void msg_matrix_free(struct msg_matrix *m);
+
+/// FNV-1a hash of all codes in the matrix, including the checksums, to identify a search.
+uint32_t msg_matrix_hash(struct msg_matrix const *m);
+
 #endif /* INCLUDE_CODES_H_ */
@@ -0,0 +1,157 @@
+/** @file
+    gf2.h: linear systems over GF(2) with up to 16 unknowns.
+
+    Copyright (C) 2019 Christian W. Zuckschwerdt <zany@triq.net>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_GF2_H_
+#define INCLUDE_GF2_H_
+
+#include <stdint.h>
+
+#include "intrinsic.h"
+
+#define GF2_COLS_MAX 16
+
+/// A system of linear equations over GF(2), kept in echelon form.
+/// Each row holds the coefficients in the low 16 bits and the right hand side in bit 16,
+/// pivot[c] is the row whose lowest coefficient bit is c, or 0 if there is none.
+struct gf2_system {
+    unsigned cols;
+    unsigned rank;
+    int inconsistent;
+    uint32_t pivot[GF2_COLS_MAX];
+};
+
+static inline void gf2_init(struct gf2_system *sys, unsigned cols)
+{
+    sys->cols         = cols;
+    sys->rank         = 0;
+    sys->inconsistent = 0;
+    for (unsigned c = 0; c < GF2_COLS_MAX; ++c) {
+        sys->pivot[c] = 0;
+    }
+}
+
+/// Add the equation `parity(coef & x) == rhs`, eliminating against the known pivots.
+/// Returns 0 if the system became inconsistent, 1 otherwise.
+static inline int gf2_add_row(struct gf2_system *sys, uint16_t coef, int rhs)
+{
+    uint32_t row = coef | (uint32_t)(rhs & 1) << 16;
+    while (row & 0xffff) {
+        int c = ctz(row & 0xffff);
+        if (!sys->pivot[c]) {
+            sys->pivot[c] = row;
+            sys->rank++;
+            return 1;
+        }
+        row ^= sys->pivot[c];
+    }
+    if (row) {
+        sys->inconsistent = 1;
+    }
+    return !sys->inconsistent;
+}
+
+/// Solve a consistent system by back substitution.
+/// Writes one particular solution and a basis of the null space (free columns set one at a time).
+/// Returns the dimension of the null space, i.e. there are 2^dim solutions.
+static inline unsigned gf2_solve(struct gf2_system const *sys, uint16_t *particular, uint16_t nullspace[GF2_COLS_MAX])
+{
+    uint16_t x = 0;
+    for (int c = sys->cols - 1; c >= 0; --c) {
+        uint32_t row = sys->pivot[c];
+        if (row && ((row >> 16) ^ parity(row & x)))
+            x |= 1 << c;
+    }
+    *particular = x;
+
+    unsigned dim = 0;
+    for (unsigned f = 0; f < sys->cols; ++f) {
+        if (sys->pivot[f])
+            continue;
+        uint16_t v = 1 << f;
+        for (int c = sys->cols - 1; c >= 0; --c) {
+            uint32_t row = sys->pivot[c];
+            if (row && parity(row & 0xffff & v))
+                v |= 1 << c;
+        }
+        nullspace[dim++] = v;
+    }
+    return dim;
+}
+
+/// Enumerate the n-th solution of a solved system, given as particular solution and null space basis.
+static inline uint16_t gf2_solution(uint16_t particular, uint16_t const nullspace[GF2_COLS_MAX], unsigned n)
+{
+    uint16_t x = particular;
+    for (unsigned j = 0; n; ++j, n >>= 1) {
+        if (n & 1)
+            x ^= nullspace[j];
+    }
+    return x;
+}
+
+/*
+The xor digest of the Galois and Fibonacci LFSRs is linear over GF(2) in the key for a fixed gen,
+i.e. the digest is the XOR of the digests for each single key bit set.
+A key with a constant final XOR then satisfies (A_i ^ A_0) key == chk_i ^ chk_0 for every message i,
+which is solved by elimination instead of trying all keys.
+The linear map is given as cols[i * width + b], the digest of message i for only key bit b set.
+*/
+
+/// The keys of a solved system: 2^dim keys from a particular solution and a null space basis.
+struct gf2_keys {
+    uint16_t particular;
+    uint16_t nullspace[GF2_COLS_MAX];
+    unsigned count;
+};
+
+/// The xor digest of message @p i for key @p k, using the linear map of @p width key bits.
+__attribute__((always_inline))
+static inline uint16_t gf2_digest(uint16_t const *cols, unsigned width, unsigned i, unsigned k)
+{
+    uint16_t dx = 0;
+    for (unsigned b = 0; b < width; ++b) {
+        if ((k >> b) & 1)
+            dx ^= cols[i * width + b];
+    }
+    return dx;
+}
+
+/// Solve for the keys of @p width bits with a constant final XOR over all @p n messages.
+/// Returns the number of keys, 0 if the messages are inconsistent.
+static inline unsigned gf2_solve_keys(uint16_t const *cols, uint16_t const *chk, unsigned width, unsigned n, struct gf2_keys *keys)
+{
+    struct gf2_system sys;
+    gf2_init(&sys, width);
+    for (unsigned i = 1; i < n && !sys.inconsistent; ++i) {
+        uint16_t rhs = chk[i] ^ chk[0];
+        for (unsigned r = 0; r < width; ++r) {
+            uint16_t coef = 0;
+            for (unsigned b = 0; b < width; ++b) {
+                coef |= (((cols[i * width + b] ^ cols[b]) >> r) & 1) << b;
+            }
+            if (!gf2_add_row(&sys, coef, rhs >> r))
+                break;
+        }
+    }
+    if (sys.inconsistent)
+        return keys->count = 0;
+
+    keys->count = 1u << gf2_solve(&sys, &keys->particular, keys->nullspace);
+    return keys->count;
+}
+
+/// The @p n-th key of a solved system.
+static inline unsigned gf2_key(struct gf2_keys const *keys, unsigned n)
+{
+    return gf2_solution(keys->particular, keys->nullspace, n);
+}
+
+#endif /* INCLUDE_GF2_H_ */
@@ -9,6 +9,9 @@
     (at your option) any later version.
 */
 
+#ifndef INCLUDE_INTRINSIC_H_
+#define INCLUDE_INTRINSIC_H_
+
 #ifdef __GNUC__
 
 __attribute__((always_inline))
@@ -29,6 +32,13 @@ static inline int parityll(unsigned x)
     return __builtin_parityll(x);
 }
 
+/// Count trailing zero bits, x must not be zero.
+__attribute__((always_inline))
+static inline int ctz(unsigned x)
+{
+    return __builtin_ctz(x);
+}
+
 #else
 #warning No builtin popcount
 
@@ -57,4 +67,18 @@ static inline int parityll(unsigned long long x)
     return parity(x ^ (x >> 32));
 }
 
+/// Count trailing zero bits, x must not be zero.
+__attribute__((always_inline))
+static inline int ctz(unsigned x)
+{
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+
 #endif
+
+#endif /* INCLUDE_INTRINSIC_H_ */
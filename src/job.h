@@ -9,37 +9,310 @@
     (at your option) any later version.
 */
 
+#ifndef INCLUDE_JOB_H_
+#define INCLUDE_JOB_H_
+
 #include <stdlib.h>
 #include <stdio.h>
 
 #include <stdatomic.h>
+
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <unistd.h>
 
-#define MAX_CPUS 128
+#include "measure.h"
+
+/*
+A pool of threads is created once and then runs any number of batches of jobs.
+A batch is a job function, a context pointer passed to every call, a count of jobs, and a chunk size.
+
+Each thread owns a deque of job numbers, a contiguous range it takes chunks of jobs from the front of.
+An idle thread steals the back half of the range of another thread.
+Jobs should be small tiles of work so that all threads stay busy until the last tile,
+use a larger chunk size if jobs are so small that taking them would show up in a profile.
+*/
+
+typedef void (*job_fn)(void *ctx, int job);
+
+struct job_deque {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+};
+
+struct job_pool;
+
+struct job_worker {
+    struct job_pool *pool;
+    pthread_t thread;
+    int self;
+    struct job_deque deque;
+};
+
+struct job_pool {
+    int threads;
+    int pin;
+    struct job_worker *workers;
+    struct progress_counter *counters; // one per worker
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;  // a new batch or shutdown
+    pthread_cond_t finish; // the last worker is done with the batch
+    unsigned batch;
+    int running;
+    int shutdown;
+
+    job_fn call;
+    void *ctx;
+    int chunk;
+};
+
+static int job_shard_index = 0;
+static int job_shard_count = 1;
 
-static int job_count;
-static _Atomic int job_next;
-static int (*job_call)(int);
+/*
+Cancellation is a single flag, set once and never cleared. Workers take no new job once it is set,
+and long running jobs should poll job_cancelled() between small steps, e.g. per generator.
+*/
+
+static atomic_int job_cancel_flag;
 
-static void *job_runner(void *args)
+/// Request all workers to stop, returns nonzero if this was already requested.
+static int job_cancel(void)
 {
+    return atomic_exchange(&job_cancel_flag, 1);
+}
+
+/// Check if workers should stop, a relaxed load that is cheap enough for inner loops.
+static inline int job_cancelled(void)
+{
+    return atomic_load_explicit(&job_cancel_flag, memory_order_relaxed);
+}
+
+/// Only run every count-th job starting at index, to split a search across hosts.
+static void job_shard(int index, int count)
+{
+    job_shard_index = index;
+    job_shard_count = count;
+}
+
+/// Parse a shard argument of "i/n" with 1 <= i <= n. Returns 0 on success.
+static int job_parse_shard(char const *arg)
+{
+    int index = 0;
+    int count = 0;
+    if (!arg || sscanf(arg, "%d/%d", &index, &count) != 2 || count < 1 || index < 1 || index > count) {
+        fprintf(stderr, "Bad shard \"%s\", expected i/n with 1 <= i <= n.\n", arg ? arg : "");
+        return -1;
+    }
+    job_shard(index - 1, count);
+    return 0;
+}
+
+// number of jobs in this shard
+static int job_shard_jobs(int count)
+{
+    return count > job_shard_index ? (count - job_shard_index + job_shard_count - 1) / job_shard_count : 0;
+}
+
+// number of the jobs first to first + count - 1 in this shard
+static int job_shard_range(int first, int count)
+{
+    return job_shard_jobs(first + count) - job_shard_jobs(first);
+}
+
+/*
+A monitor thread can print the progress of a batch to stderr every few seconds:
+the share of jobs done, the candidates per second as counted with progress_add(), and an ETA.
+With progress enabled a batch that counted any candidates ends with a summary of the total and the rate.
+*/
+
+static int job_progress_interval = -1;
+static atomic_int job_done_count;
+
+struct job_monitor {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t stop_cond;
+    int stop;
+    int jobs;
+    struct timespec start;
+    unsigned long long base;
+};
+
+static double job_monitor_elapsed(struct job_monitor const *mon)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - mon->start.tv_sec) + (now.tv_nsec - mon->start.tv_nsec) / 1000000000.0;
+}
+
+/// Print progress every @p seconds while jobs are running, 0 for the summary only.
+static void job_progress(int seconds)
+{
+    job_progress_interval = seconds;
+}
+
+static void *job_monitor_thread(void *args)
+{
+    struct job_monitor *mon = args;
+
+    struct timespec wake;
+    clock_gettime(CLOCK_REALTIME, &wake);
+    pthread_mutex_lock(&mon->lock);
+    while (!mon->stop) {
+        wake.tv_sec += job_progress_interval;
+        while (!mon->stop && pthread_cond_timedwait(&mon->stop_cond, &mon->lock, &wake) == 0)
+            ; // spurious wakeup
+        if (mon->stop)
+            break;
+
+        double elapsed = job_monitor_elapsed(mon);
+        int done       = atomic_load_explicit(&job_done_count, memory_order_relaxed);
+        double rate    = (progress_total() - mon->base) / elapsed;
+        if (done > 0) {
+            double eta = elapsed * (mon->jobs - done) / done;
+            fprintf(stderr, "Progress: %.1f %% (%d/%d jobs), %.3g candidates/s, ETA %02d:%02d:%02d\n",
+                    100.0 * done / mon->jobs, done, mon->jobs, rate,
+                    (int)eta / 3600, (int)eta / 60 % 60, (int)eta % 60);
+        }
+        else {
+            fprintf(stderr, "Progress: 0 %% (0/%d jobs), %.3g candidates/s, ETA unknown\n", mon->jobs, rate);
+        }
+    }
+    pthread_mutex_unlock(&mon->lock);
+
+    return NULL;
+}
+
+static void job_monitor_start(struct job_monitor *mon, int jobs)
+{
+    atomic_store(&job_done_count, 0);
+    mon->stop = 0;
+    mon->jobs = jobs;
+    clock_gettime(CLOCK_MONOTONIC, &mon->start);
+    mon->base = progress_total();
+    if (job_progress_interval <= 0 || jobs <= 0)
+        return;
+    pthread_mutex_init(&mon->lock, NULL);
+    pthread_cond_init(&mon->stop_cond, NULL);
+    if (pthread_create(&mon->thread, NULL, job_monitor_thread, mon)) {
+        perror("job_monitor_start pthread_create");
+        exit(1);
+    }
+}
+
+static void job_monitor_stop(struct job_monitor *mon)
+{
+    if (job_progress_interval > 0 && mon->jobs > 0) {
+        pthread_mutex_lock(&mon->lock);
+        mon->stop = 1;
+        pthread_cond_signal(&mon->stop_cond);
+        pthread_mutex_unlock(&mon->lock);
+        pthread_join(mon->thread, NULL);
+        pthread_cond_destroy(&mon->stop_cond);
+        pthread_mutex_destroy(&mon->lock);
+    }
+
+    double elapsed               = job_monitor_elapsed(mon);
+    unsigned long long evaluated = progress_total() - mon->base;
+    if (job_progress_interval < 0 || !evaluated)
+        return;
+    fprintf(stderr, "Progress: done %d/%d jobs, %llu candidates in %.3f s, %.3g candidates/s\n",
+            atomic_load(&job_done_count), mon->jobs, evaluated, elapsed, evaluated / elapsed);
+}
+
+/// Take the next chunk from the own deque or steal from another thread, returns the number of jobs taken.
+static int job_take(struct job_pool *pool, int self, int *first)
+{
+    struct job_deque *own = &pool->workers[self].deque;
+
     for (;;) {
-        int job = atomic_fetch_add(&job_next, 1);
+        pthread_mutex_lock(&own->lock);
+        int left = own->end - own->next;
+        int n    = left < pool->chunk ? left : pool->chunk;
+        *first   = own->next;
+        own->next += n;
+        pthread_mutex_unlock(&own->lock);
+        if (n > 0)
+            return n;
+
+        int stolen = 0;
+        for (int i = 1; i < pool->threads && !stolen; ++i) {
+            struct job_deque *victim = &pool->workers[(self + i) % pool->threads].deque;
 
-        if (job >= job_count)
-            return NULL;
+            pthread_mutex_lock(&victim->lock);
+            left    = victim->end - victim->next;
+            int end = victim->end;
+            if (left > 0)
+                victim->end -= (left + 1) / 2;
+            int start = victim->end;
+            pthread_mutex_unlock(&victim->lock);
 
-        job_call(job);
+            if (left > 0) {
+                pthread_mutex_lock(&own->lock);
+                own->next = start;
+                own->end  = end;
+                pthread_mutex_unlock(&own->lock);
+                stolen = 1;
+            }
+        }
+        if (!stolen)
+            return 0;
     }
 }
 
-static void job_exec_sequential(int (*call)(int))
+static void job_pin(int self)
+{
+#if defined(__linux__) && defined(CPU_SET)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(self % CPU_SETSIZE, &set);
+    if (sched_setaffinity(0, sizeof(set), &set))
+        perror("job_pin sched_setaffinity");
+#else
+    (void)self;
+    fprintf(stderr, "Pinning threads to CPUs is not supported here.\n");
+#endif
+}
+
+static void *job_pool_thread(void *args)
 {
-    int count = call(-1);
-    for (int i = 0; i < count; ++i) {
-        call(i);
+    struct job_worker *worker = args;
+    struct job_pool *pool     = worker->pool;
+    unsigned batch            = 0;
+
+    if (pool->pin)
+        job_pin(worker->self);
+    progress_register(&pool->counters[worker->self]);
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->batch == batch && !pool->shutdown)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->shutdown)
+            break;
+        batch = pool->batch;
+        pthread_mutex_unlock(&pool->lock);
+
+        int first;
+        int n;
+        while (!job_cancelled() && (n = job_take(pool, worker->self, &first)) > 0) {
+            for (int job = first; job < first + n && !job_cancelled(); ++job) {
+                pool->call(pool->ctx, job_shard_index + job * job_shard_count);
+                atomic_fetch_add_explicit(&job_done_count, 1, memory_order_relaxed);
+            }
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0)
+            pthread_cond_signal(&pool->finish);
     }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
 }
 
 static int job_default_thread_count(void)
@@ -47,29 +320,119 @@ static int job_default_thread_count(void)
     return sysconf(_SC_NPROCESSORS_ONLN); // Get the number of logical CPUs.
 }
 
-static void job_exec_parallel(int (*call)(int), int numofthreads)
+/// Start a pool of threads, all logical CPUs if @p threads is not positive, optionally pinned to one CPU each.
+static struct job_pool *job_pool_create(int threads, int pin)
 {
-    pthread_t thread[MAX_CPUS]; // numofthreads
-    int args[MAX_CPUS];         // numofthreads
-
-    if (numofthreads <= 0)
-        numofthreads = job_default_thread_count();
-    fprintf(stderr, "Running %d threads...\n", numofthreads);
+    if (threads <= 0)
+        threads = job_default_thread_count();
+    if (threads <= 0)
+        threads = 1;
 
-    job_count = call(-1);
-    atomic_store_explicit(&job_next, 0, memory_order_relaxed);
-    job_call = call;
+    struct job_pool *pool = calloc(1, sizeof(*pool));
+    if (!pool || !(pool->workers = calloc(threads, sizeof(*pool->workers)))) {
+        perror("job_pool_create calloc");
+        exit(1);
+    }
+    pool->counters = aligned_alloc(64, threads * sizeof(*pool->counters));
+    if (!pool->counters) {
+        perror("job_pool_create aligned_alloc");
+        exit(1);
+    }
+    pool->threads = threads;
+    pool->pin     = pin;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->finish, NULL);
 
-    for (int i = 0; i < numofthreads; ++i) {
-        args[i] = i;
-        int ret = pthread_create(&thread[i], NULL, job_runner, (void *)&args[i]);
+    for (int i = 0; i < threads; ++i) {
+        struct job_worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->self = i;
+        pthread_mutex_init(&worker->deque.lock, NULL);
+        int ret = pthread_create(&worker->thread, NULL, job_pool_thread, worker);
         if (ret) {
-            perror("job_exec_parallel pthread_create");
+            perror("job_pool_create pthread_create");
             exit(1);
         }
     }
 
-    for (int i = 0; i < numofthreads; ++i) {
-        pthread_join(thread[i], NULL);
+    return pool;
+}
+
+/// Run a batch of @p count jobs (of this shard) on the pool, taken @p chunk at a time, and wait for it to finish.
+static void job_pool_run(struct job_pool *pool, job_fn call, void *ctx, int count, int chunk)
+{
+    int jobs = job_shard_jobs(count);
+
+    // initially split the jobs evenly, the workers are idle now
+    for (int i = 0; i < pool->threads; ++i) {
+        struct job_deque *deque = &pool->workers[i].deque;
+        pthread_mutex_lock(&deque->lock);
+        deque->next = (long)jobs * i / pool->threads;
+        deque->end  = (long)jobs * (i + 1) / pool->threads;
+        pthread_mutex_unlock(&deque->lock);
     }
+
+    struct job_monitor mon;
+    job_monitor_start(&mon, jobs);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->call    = call;
+    pool->ctx     = ctx;
+    pool->chunk   = chunk > 0 ? chunk : 1;
+    pool->running = pool->threads;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->running > 0)
+        pthread_cond_wait(&pool->finish, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    job_monitor_stop(&mon);
 }
+
+static void job_pool_destroy(struct job_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+        pthread_mutex_destroy(&pool->workers[i].deque.lock);
+        progress_unregister(&pool->counters[i]);
+    }
+
+    pthread_cond_destroy(&pool->finish);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->counters);
+    free(pool->workers);
+    free(pool);
+}
+
+/// Run @p count jobs (of this shard) in the calling thread.
+static void job_exec_sequential(job_fn call, void *ctx, int count)
+{
+    struct job_monitor mon;
+    job_monitor_start(&mon, job_shard_jobs(count));
+
+    for (int i = job_shard_index; i < count && !job_cancelled(); i += job_shard_count) {
+        call(ctx, i);
+        atomic_fetch_add_explicit(&job_done_count, 1, memory_order_relaxed);
+    }
+
+    job_monitor_stop(&mon);
+}
+
+/// Run @p count jobs (of this shard) on a pool that only lives for this one batch.
+/// For tools that run a single batch, e.g. revdgst and revdgst16, use the pool directly to run several.
+static void job_exec_parallel(job_fn call, void *ctx, int count, int threads, int pin)
+{
+    struct job_pool *pool = job_pool_create(threads, pin);
+    fprintf(stderr, "Running %d threads...\n", pool->threads);
+    job_pool_run(pool, call, ctx, count, 1);
+    job_pool_destroy(pool);
+}
+
+#endif /* INCLUDE_JOB_H_ */
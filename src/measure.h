@@ -9,7 +9,13 @@
     (at your option) any later version.
 */
 
+#ifndef INCLUDE_MEASURE_H_
+#define INCLUDE_MEASURE_H_
+
+#include <stdlib.h>
 #include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <time.h>
 #include <sys/times.h>
 #include <unistd.h>
@@ -36,6 +42,282 @@
         printf("Time elapsed in s: %.2f for: %s\n\n", elapsed, label);     \
     } while (0)
 
+/*
+Instrumentation of the search kernels, compiled out unless INSTRUMENT is defined (cmake -DENABLE_INSTRUMENT=ON).
+Kernels count with INSTR_ADD() into plain thread local counters, MEASURE_TILES() sums the
+difference over each tile and prints the totals with the time of the job.
+With INSTRUMENT_PERF (cmake -DENABLE_PERF_EVENTS=ON) cycles, instructions, and branch-misses
+of the thread are read from perf_event_open(2) as well.
+*/
+
+#define INSTR_COMBINERS 6
+
+#ifdef INSTRUMENT
+
+#include <string.h>
+
+#ifdef INSTRUMENT_PERF
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+enum instr_counter {
+    INSTR_CANDIDATES,   ///< keys tried
+    INSTR_SCORED,       ///< messages scored before giving up
+    INSTR_SURVIVORS,    ///< keys reaching min_matches, one counter per combiner
+    INSTR_CYCLES = INSTR_SURVIVORS + INSTR_COMBINERS,
+    INSTR_INSTRUCTIONS,
+    INSTR_BRANCH_MISSES,
+    INSTR_COUNT,
+};
+
+static _Thread_local unsigned long long instr_local[INSTR_COUNT];
+
+#define INSTR_ADD(counter, n) (instr_local[counter] += (n))
+
+#ifdef INSTRUMENT_PERF
+static _Thread_local int instr_perf_fd[3] = {-2, -2, -2};
+
+static void instr_perf_read(unsigned long long *cnt)
+{
+    static unsigned long long const configs[3] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    for (int i = 0; i < 3; ++i) {
+        if (instr_perf_fd[i] == -2) {
+            struct perf_event_attr attr = {0};
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.size           = sizeof(attr);
+            attr.config         = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            // this thread on any CPU
+            instr_perf_fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (instr_perf_fd[i] < 0 && i == 0)
+                perror("perf_event_open");
+        }
+        unsigned long long val = 0;
+        if (instr_perf_fd[i] >= 0 && read(instr_perf_fd[i], &val, sizeof(val)) != sizeof(val))
+            val = 0;
+        cnt[INSTR_CYCLES + i] = val;
+    }
+}
+#else
+static void instr_perf_read(unsigned long long *cnt)
+{
+    (void)cnt;
+}
+#endif
+
+static void instr_begin(unsigned long long *snap)
+{
+    instr_perf_read(instr_local);
+    memcpy(snap, instr_local, sizeof(instr_local));
+}
+
+static void instr_end(unsigned long long const *snap, _Atomic unsigned long long *totals)
+{
+    instr_perf_read(instr_local);
+    for (int i = 0; i < INSTR_COUNT; ++i)
+        atomic_fetch_add(&totals[i], instr_local[i] - snap[i]);
+}
+
+static void instr_print(char const *label, _Atomic unsigned long long *totals)
+{
+    unsigned long long t[INSTR_COUNT];
+    for (int i = 0; i < INSTR_COUNT; ++i)
+        t[i] = atomic_load(&totals[i]);
+    printf("Counters for: %s: candidates %llu, messages scored %llu (%.2f per candidate)\n",
+            label, t[INSTR_CANDIDATES], t[INSTR_SCORED],
+            t[INSTR_CANDIDATES] ? (double)t[INSTR_SCORED] / t[INSTR_CANDIDATES] : 0.0);
+    printf("  survivors sum xor %llu, xor xor %llu, sum add %llu, xor add %llu, sum sub %llu, xor sub %llu\n",
+            t[INSTR_SURVIVORS + 0], t[INSTR_SURVIVORS + 1], t[INSTR_SURVIVORS + 2],
+            t[INSTR_SURVIVORS + 3], t[INSTR_SURVIVORS + 4], t[INSTR_SURVIVORS + 5]);
+#ifdef INSTRUMENT_PERF
+    printf("  cycles %llu, instructions %llu (%.2f IPC), branch-misses %llu\n",
+            t[INSTR_CYCLES], t[INSTR_INSTRUCTIONS],
+            t[INSTR_CYCLES] ? (double)t[INSTR_INSTRUCTIONS] / t[INSTR_CYCLES] : 0.0,
+            t[INSTR_BRANCH_MISSES]);
+#endif
+}
+
+#define INSTR_TILE_DECL unsigned long long instr_snap[INSTR_COUNT]
+#define INSTR_TILE_BEGIN instr_begin(instr_snap)
+#define INSTR_TILE_END(site) instr_end(instr_snap, (site)->instr_totals)
+#define INSTR_TILE_PRINT(site) instr_print((site)->label, (site)->instr_totals)
+
+#else /* !INSTRUMENT */
+
+#define INSTR_ADD(counter, n) ((void)0)
+
+#define INSTR_TILE_DECL ((void)0)
+#define INSTR_TILE_BEGIN ((void)0)
+#define INSTR_TILE_END(site) ((void)0)
+#define INSTR_TILE_PRINT(site) ((void)0)
+
+#endif /* INSTRUMENT */
+
+/*
+Every MEASURE_TILES site sums the time of its tiles and prints it once the last tile is done.
+The sites are kept in a list, so that measure_tiles_flush() can print the sites
+that did not get to run all their tiles, e.g. when a search was cancelled.
+Sites with a tile count of 0 are only printed by measure_tiles_flush(),
+in the order they were registered, e.g. to keep the output the same for any number of threads.
+*/
+
+struct measure_tiles {
+    char const *label;
+    int tiles;
+    _Atomic long long total_nsec;
+    _Atomic int done;
+    _Atomic int printed;
+    atomic_flag registered;
+    struct measure_tiles *next;
+#ifdef INSTRUMENT
+    _Atomic unsigned long long instr_totals[INSTR_COUNT];
+#endif
+};
+
+static struct measure_tiles *_Atomic measure_tiles_list;
+
+static void measure_tiles_print(struct measure_tiles *site)
+{
+    if (atomic_exchange(&site->printed, 1))
+        return;
+    double elapsed = atomic_load(&site->total_nsec) / 1000000000.0;
+    int done       = atomic_load(&site->done);
+    INSTR_TILE_PRINT(site);
+    if (site->tiles && done < site->tiles)
+        printf("Time elapsed in s: %.3f for: %s (%d of %d tiles)\n\n", elapsed, site->label, done, site->tiles);
+    else
+        printf("Time elapsed in s: %.3f for: %s\n\n", elapsed, site->label);
+}
+
+/// Register a site before its tiles run, so that it is printed even if none of them runs.
+static void measure_tiles_init(struct measure_tiles *site, int tiles, char const *label)
+{
+    if (atomic_flag_test_and_set(&site->registered))
+        return;
+    site->label = label;
+    site->tiles = tiles;
+    site->next  = atomic_load(&measure_tiles_list);
+    while (!atomic_compare_exchange_weak(&measure_tiles_list, &site->next, site))
+        ;
+}
+
+static void measure_tiles_add(struct measure_tiles *site, int tiles, char const *label, long long nsec)
+{
+    measure_tiles_init(site, tiles, label);
+    atomic_fetch_add(&site->total_nsec, nsec);
+    if (atomic_fetch_add(&site->done, 1) + 1 == tiles && tiles)
+        measure_tiles_print(site);
+}
+
+static void measure_tiles_flush_from(struct measure_tiles *site)
+{
+    if (!site)
+        return;
+    measure_tiles_flush_from(site->next); // oldest first
+    measure_tiles_print(site);
+}
+
+/// Print the sites that did not run all their tiles, call this while no jobs are running.
+static void measure_tiles_flush(void)
+{
+    measure_tiles_flush_from(atomic_load(&measure_tiles_list));
+}
+
+/// Measure wall clock time of one tile of a job that is split into tiles.
+/// The sum over all tiles is printed once the last tile is done, with the instrumentation counters if enabled.
+#define MEASURE_TILES(tiles, label, block)                                 \
+    do {                                                                   \
+        static struct measure_tiles tiles_site = {.registered = ATOMIC_FLAG_INIT}; \
+        MEASURE_TILES_AT(&tiles_site, tiles, label, block);                \
+    } while (0)
+
+/// Measure one tile like MEASURE_TILES, summed in the given site.
+#define MEASURE_TILES_AT(site, tiles, label, block)                        \
+    do {                                                                   \
+        INSTR_TILE_DECL;                                                   \
+        struct timespec start, finish;                                     \
+        INSTR_TILE_BEGIN;                                                  \
+        clock_gettime(CLOCK_MONOTONIC, &start);                            \
+        block;                                                             \
+        clock_gettime(CLOCK_MONOTONIC, &finish);                           \
+        INSTR_TILE_END(site);                                              \
+        long long nsec = (finish.tv_sec - start.tv_sec) * 1000000000LL;    \
+        nsec += finish.tv_nsec - start.tv_nsec;                            \
+        measure_tiles_add((site), (tiles), (label), nsec);                 \
+    } while (0)
+
+/*
+Progress counters: every thread counts the candidates it evaluated in a counter of its own cache line.
+Only the owning thread writes, with a relaxed load and store, a monitor sums all counters now and then.
+The counters of pool workers are owned by the pool, other threads share the process counter.
+*/
+
+struct progress_counter {
+    _Alignas(64) _Atomic unsigned long long count;
+    struct progress_counter *next;
+};
+
+static _Thread_local struct progress_counter *progress_local;
+static struct progress_counter progress_process;
+static struct progress_counter *progress_counters = &progress_process;
+static unsigned long long progress_retired; // counts of the unregistered counters
+static pthread_mutex_t progress_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// Count the candidates of this thread in @p c, until progress_unregister().
+static void progress_register(struct progress_counter *c)
+{
+    atomic_init(&c->count, 0);
+    pthread_mutex_lock(&progress_lock);
+    c->next           = progress_counters;
+    progress_counters = c;
+    pthread_mutex_unlock(&progress_lock);
+    progress_local = c;
+}
+
+/// Keep the counts of @p c in the total, its owner must not count anymore.
+static void progress_unregister(struct progress_counter *c)
+{
+    pthread_mutex_lock(&progress_lock);
+    struct progress_counter **p = &progress_counters;
+    while (*p && *p != c)
+        p = &(*p)->next;
+    if (*p) {
+        *p = c->next;
+        progress_retired += atomic_load_explicit(&c->count, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&progress_lock);
+}
+
+/// Count evaluated candidates of this thread, cheap enough to call once per generator.
+static inline void progress_add(unsigned long long n)
+{
+    struct progress_counter *c = progress_local;
+    if (!c) {
+        atomic_fetch_add_explicit(&progress_process.count, n, memory_order_relaxed);
+        return;
+    }
+    unsigned long long count = atomic_load_explicit(&c->count, memory_order_relaxed);
+    atomic_store_explicit(&c->count, count + n, memory_order_relaxed);
+}
+
+/// Sum of the evaluated candidates of all threads.
+static unsigned long long progress_total(void)
+{
+    pthread_mutex_lock(&progress_lock);
+    unsigned long long total = progress_retired;
+    for (struct progress_counter *c = progress_counters; c; c = c->next)
+        total += atomic_load_explicit(&c->count, memory_order_relaxed);
+    pthread_mutex_unlock(&progress_lock);
+    return total;
+}
+
 static clock_t start_time_real;
 
 /// Capture overall process time used, in the style of "time" command.
@@ -61,3 +343,5 @@ static void print_runtimes(void)
 }
 
 // s.a. pthread_getcpuclockid(3)
+
+#endif /* INCLUDE_MEASURE_H_ */
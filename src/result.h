@@ -0,0 +1,186 @@
+/** @file
+    result.h: collect search results and write them as mergeable result files.
+
+    Copyright (C) 2019 Christian W. Zuckschwerdt <zany@triq.net>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#ifndef INCLUDE_RESULT_H_
+#define INCLUDE_RESULT_H_
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pthread.h>
+
+/*
+A result file has one line per match with tab separated fields:
+matches, total, gen, key, final (in hex), combiner, and variant name.
+Lines starting with '#' are comments. The lines are sorted by variant, gen, key, and combiner,
+so the file of a search is the same on every run and for any number of threads.
+*/
+
+struct result {
+    unsigned matches;
+    unsigned total;
+    unsigned gen;
+    unsigned key;
+    unsigned final;
+    int variant;
+    char const *combiner;
+    char const *variant_name;
+};
+
+/*
+Every thread appends to its own buffer, without locking, and only registers that buffer once.
+After a batch of jobs result_collect() merges all buffers into one sorted list,
+so the output does not depend on the number of threads or their scheduling.
+*/
+
+struct result_buf {
+    struct result *list;
+    unsigned len;
+    unsigned cap;
+    struct result_buf *next;
+};
+
+static _Thread_local struct result_buf *result_local;
+static struct result_buf *result_bufs;
+static pthread_mutex_t result_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the collected and sorted results
+static struct result *result_list;
+static unsigned result_len;
+
+static void result_grow(struct result **list, unsigned *cap, unsigned len)
+{
+    if (len < *cap)
+        return;
+    *cap  = *cap ? *cap * 2 : 64;
+    *list = realloc(*list, *cap * sizeof(**list));
+    if (!*list) {
+        perror("result_grow realloc");
+        exit(1);
+    }
+}
+
+static void result_add(struct result const *r)
+{
+    struct result_buf *buf = result_local;
+    if (!buf) {
+        buf = calloc(1, sizeof(*buf));
+        if (!buf) {
+            perror("result_add calloc");
+            exit(1);
+        }
+        pthread_mutex_lock(&result_lock);
+        buf->next   = result_bufs;
+        result_bufs = buf;
+        pthread_mutex_unlock(&result_lock);
+        result_local = buf;
+    }
+    result_grow(&buf->list, &buf->cap, buf->len);
+    buf->list[buf->len++] = *r;
+}
+
+static int result_cmp(void const *a, void const *b)
+{
+    struct result const *ra = a;
+    struct result const *rb = b;
+    if (ra->variant != rb->variant)
+        return ra->variant < rb->variant ? -1 : 1;
+    if (ra->gen != rb->gen)
+        return ra->gen < rb->gen ? -1 : 1;
+    if (ra->key != rb->key)
+        return ra->key < rb->key ? -1 : 1;
+    int c = strcmp(ra->combiner, rb->combiner);
+    if (c)
+        return c;
+    if (ra->final != rb->final)
+        return ra->final < rb->final ? -1 : 1;
+    return 0;
+}
+
+/// Move the results of all threads to the sorted result_list, call this while no jobs are running.
+static void result_collect(void)
+{
+    unsigned cap = result_len;
+    pthread_mutex_lock(&result_lock);
+    for (struct result_buf *buf = result_bufs; buf; buf = buf->next) {
+        for (unsigned i = 0; i < buf->len; ++i) {
+            result_grow(&result_list, &cap, result_len);
+            result_list[result_len++] = buf->list[i];
+        }
+        buf->len = 0;
+    }
+    pthread_mutex_unlock(&result_lock);
+
+    if (result_len)
+        qsort(result_list, result_len, sizeof(*result_list), result_cmp);
+}
+
+static void result_print(FILE *fp, struct result const *r)
+{
+    fprintf(fp, "%u\t%u\t%04x\t%04x\t%04x\t%s\t%s\n",
+            r->matches, r->total, r->gen, r->key, r->final, r->combiner, r->variant_name);
+}
+
+/// Parse a result line in place, the strings will point into the line. Returns 0 on success.
+static int result_parse(char *line, struct result *r)
+{
+    int pos = 0;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (sscanf(line, "%u\t%u\t%x\t%x\t%x\t%n", &r->matches, &r->total, &r->gen, &r->key, &r->final, &pos) != 5 || !pos)
+        return -1;
+    char *tab = strchr(line + pos, '\t');
+    if (!tab || !r->total)
+        return -1;
+    *tab = '\0';
+    r->combiner     = line + pos;
+    r->variant_name = tab + 1;
+    r->variant      = -1;
+    return 0;
+}
+
+/// Write all collected results with a header comment. Returns 0 on success.
+static int result_write(char const *filename, char const *header)
+{
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return -1;
+    }
+
+    fprintf(fp, "# %s\n", header);
+    for (unsigned i = 0; i < result_len; ++i) {
+        result_print(fp, &result_list[i]);
+    }
+
+    int ret = ferror(fp) ? -1 : 0;
+    fclose(fp);
+    return ret;
+}
+
+/// Free all results, call this once all other threads that added results have ended.
+static void result_free(void)
+{
+    struct result_buf *buf = result_bufs;
+    while (buf) {
+        struct result_buf *next = buf->next;
+        free(buf->list);
+        free(buf);
+        buf = next;
+    }
+    result_bufs  = NULL;
+    result_local = NULL;
+    free(result_list);
+    result_list = NULL;
+    result_len  = 0;
+}
+
+#endif /* INCLUDE_RESULT_H_ */
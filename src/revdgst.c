@@ -12,11 +12,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "intrinsic.h"
 #include "util.h"
+#include "gf2.h"
+#include "bitslice.h"
 #include "measure.h"
 #include "codes.h"
+#include "result.h"
 
 #include "job.h"
 
@@ -24,7 +28,7 @@
 Modify these algorithms to test other possible checksum methods.
 
 You can also add more algorithms (PR if you have a nice one!).
-Remember to add any new algorithm to call_algo() and then job_run() and increase it's job count return value.
+Remember to add any new algorithm to call_algo(), declare its parameters in algo_spaces[] and then add it to job_run().
 
 Note that the reversing arguments will be expanded and optimized away when unrolling every code path in job_run().
 There is no overhead in making an algorithm consume data bits in multiple possible ways.
@@ -313,6 +317,168 @@ static inline void algo_lfsr_digest8_fibonacci(int y_rev, int i_rev, int rev,
     *sum_xor = xor;
 }
 
+/*
+For the Galois, Fibonacci and Shift16 LFSRs the sequence of keys only depends on gen, key and direction,
+not on the message. The keystream is generated once per candidate and then applied to every message.
+*/
+
+// Keystream of the Galois (algo 1), Fibonacci (algo 2), and Shift16 (algo 4) LFSR, one key per data bit.
+__attribute__((always_inline))
+static inline void algo_keystream8(int algo, int rev, int steps, uint8_t gen, uint8_t key, uint8_t *ks)
+{
+    uint16_t key16 = (gen << 8) | key;
+    for (int t = 0; t < steps; ++t) {
+        if (algo == 1) {
+            ks[t] = key;
+            if (rev)
+                key = (key & 0x80) ? (key << 1) ^ gen : (key << 1);
+            else
+                key = (key & 1) ? (key >> 1) ^ gen : (key >> 1);
+        }
+        else if (algo == 2) {
+            ks[t] = key;
+            if (rev)
+                key = (key << 1) | parity(key & gen);
+            else
+                key = (key >> 1) | (parity(key & gen) << 7);
+        }
+        else {
+            ks[t] = key16 & 0xff;
+            // the Shift16 register just rotates
+            if (rev)
+                key16 = (key16 << 1) | (key16 >> 15);
+            else
+                key16 = (key16 >> 1) | (key16 << 15);
+        }
+    }
+}
+
+// Digest of a message from a precomputed keystream, step t is the t-th data bit consumed.
+__attribute__((always_inline))
+static inline void algo_keystream_digest8(int y_rev, int i_rev,
+        uint8_t const *msg, int bytes, uint8_t const *ks, uint8_t *sum_add, uint8_t *sum_xor)
+{
+    // all this will be optimized away
+    int y_min, y_max, y_step;
+    if (y_rev) {
+        y_min = bytes - 1; y_max = -1; y_step = -1;
+    } else {
+        y_min = 0; y_max = bytes; y_step = 1;
+    }
+
+    int i_min, i_max, i_step;
+    if (i_rev) {
+        i_min = 7; i_max = -1; i_step = -1;
+    }
+    else {
+        i_min = 0; i_max = 8; i_step = 1;
+    }
+
+    unsigned sum = 0;
+    uint8_t xor = 0;
+    for (int k = y_min; k != y_max; k += y_step) {
+        u_int8_t data = msg[k];
+        for (int bit = i_min; bit != i_max; bit += i_step) {
+            if ((data >> bit) & 1) {
+                sum += *ks;
+                xor ^= *ks;
+            }
+            ks++;
+        }
+    }
+    *sum_add = sum;
+    *sum_xor = xor;
+}
+
+// Bit-sliced keystream of the Galois (algo 1) and Fibonacci (algo 2) LFSR for all 256 keys at once.
+// Lane k of the planes is the keystream for key k.
+__attribute__((always_inline))
+static inline void algo_keystream8_sliced(int algo, int rev, int steps, uint8_t gen, slice_t (*ks)[8])
+{
+    slice_t key[8];
+    slice_t gm[8];
+    for (int j = 0; j < 8; ++j) {
+        key[j] = slice_index(j);
+        gm[j]  = slice_set(gen >> j);
+    }
+
+    for (int t = 0; t < steps; ++t) {
+        for (int j = 0; j < 8; ++j)
+            ks[t][j] = key[j];
+
+        if (algo == 1) {
+            // - Galois LFSR -
+            if (rev) {
+                slice_t msb = key[7];
+                for (int j = 7; j > 0; --j)
+                    key[j] = key[j - 1] ^ (gm[j] & msb);
+                key[0] = gm[0] & msb;
+            }
+            else {
+                slice_t lsb = key[0];
+                for (int j = 0; j < 7; ++j)
+                    key[j] = key[j + 1] ^ (gm[j] & lsb);
+                key[7] = gm[7] & lsb;
+            }
+        }
+        else {
+            // - Fibonacci LFSR -
+            slice_t fb = slice_set(0);
+            for (int j = 0; j < 8; ++j)
+                fb ^= gm[j] & key[j];
+            if (rev) {
+                for (int j = 7; j > 0; --j)
+                    key[j] = key[j - 1];
+                key[0] = fb;
+            }
+            else {
+                for (int j = 0; j < 7; ++j)
+                    key[j] = key[j + 1];
+                key[7] = fb;
+            }
+        }
+    }
+}
+
+// Bit-sliced digest of a message from a precomputed keystream, the data bits are the same for every lane.
+__attribute__((always_inline))
+static inline void algo_keystream_digest8_sliced(int y_rev, int i_rev,
+        uint8_t const *msg, int bytes, slice_t const (*ks)[8], slice_t sum_add[8], slice_t sum_xor[8])
+{
+    // all this will be optimized away
+    int y_min, y_max, y_step;
+    if (y_rev) {
+        y_min = bytes - 1; y_max = -1; y_step = -1;
+    } else {
+        y_min = 0; y_max = bytes; y_step = 1;
+    }
+
+    int i_min, i_max, i_step;
+    if (i_rev) {
+        i_min = 7; i_max = -1; i_step = -1;
+    }
+    else {
+        i_min = 0; i_max = 8; i_step = 1;
+    }
+
+    for (int j = 0; j < 8; ++j) {
+        sum_add[j] = slice_set(0);
+        sum_xor[j] = slice_set(0);
+    }
+
+    for (int k = y_min; k != y_max; k += y_step) {
+        u_int8_t data = msg[k];
+        for (int bit = i_min; bit != i_max; bit += i_step) {
+            if ((data >> bit) & 1) {
+                slice_add(sum_add, *ks, 8);
+                for (int j = 0; j < 8; ++j)
+                    sum_xor[j] ^= (*ks)[j];
+            }
+            ks++;
+        }
+    }
+}
+
 __attribute__((always_inline))
 static inline void call_algo(int algo, int y_rev, int i_rev, int rev,
         uint8_t const *msg, int bytes, uint8_t gen, uint8_t key, uint8_t *sum_add, uint8_t *sum_xor)
@@ -329,29 +495,390 @@ static inline void call_algo(int algo, int y_rev, int i_rev, int rev,
         {}
 }
 
-#define DONE(msg, r, s) do { printf("Done with g %02x k %02x final XOR %02x using %s (%.0f %%)\n", g, k, r, msg, s); /*exit(0);*/ } while (0)
+/*
+The bit-sliced keystream digest of a message is specialized for the common message lengths,
+with a fixed trip count the compiler fully unrolls the byte loop.
+The matching instance is selected once per runner, other lengths use the generic instance.
+The scalar digests stay inline, most candidates are rejected after a few messages.
+*/
+
+typedef void (*digest8_sliced_fn)(uint8_t const *msg, int bytes, slice_t const (*ks)[8], slice_t sum_add[8], slice_t sum_xor[8]);
+
+#define DIGEST8_SLICED_FN(len, y_rev, i_rev) \
+    static void digest8_sliced_##y_rev##i_rev##_##len(uint8_t const *msg, int bytes, slice_t const (*ks)[8], slice_t sum_add[8], slice_t sum_xor[8]) \
+    { \
+        (void)bytes; \
+        algo_keystream_digest8_sliced(y_rev, i_rev, msg, len, ks, sum_add, sum_xor); \
+    }
+#define DIGEST8_SLICED_FNS(len) \
+    DIGEST8_SLICED_FN(len, 0, 0) \
+    DIGEST8_SLICED_FN(len, 0, 1) \
+    DIGEST8_SLICED_FN(len, 1, 0) \
+    DIGEST8_SLICED_FN(len, 1, 1)
+MSG_LEN_COMMON(DIGEST8_SLICED_FNS)
+
+#define DIGEST8_SLICED_ANY(y_rev, i_rev) \
+    static void digest8_sliced_##y_rev##i_rev##_any(uint8_t const *msg, int bytes, slice_t const (*ks)[8], slice_t sum_add[8], slice_t sum_xor[8]) \
+    { \
+        algo_keystream_digest8_sliced(y_rev, i_rev, msg, bytes, ks, sum_add, sum_xor); \
+    }
+DIGEST8_SLICED_ANY(0, 0)
+DIGEST8_SLICED_ANY(0, 1)
+DIGEST8_SLICED_ANY(1, 0)
+DIGEST8_SLICED_ANY(1, 1)
+
+#define DIGEST8_SLICED_ENTRY(len) \
+    [0][0][len] = digest8_sliced_00_##len, \
+    [0][1][len] = digest8_sliced_01_##len, \
+    [1][0][len] = digest8_sliced_10_##len, \
+    [1][1][len] = digest8_sliced_11_##len,
+static digest8_sliced_fn const digest8_sliced_fns[2][2][MSG_MAX] = {MSG_LEN_COMMON(DIGEST8_SLICED_ENTRY)};
+static digest8_sliced_fn const digest8_sliced_any[2][2] = {
+        {digest8_sliced_00_any, digest8_sliced_01_any},
+        {digest8_sliced_10_any, digest8_sliced_11_any},
+};
+
+/*
+The parameter space an algorithm actually reads, the runner only enumerates distinct candidates.
+Fletcher ignores gen and takes the key nibbles modulo 15, i.e. a nibble of 0xf is the same as 0.
+*/
+
+/// Parameter space of an algorithm.
+struct algo_space {
+    unsigned gen_max;    ///< largest gen, 0 if gen is not used
+    unsigned key_max;    ///< largest key, 0 if key is not used
+    unsigned nibble_mod; ///< modulus of the key nibbles, 0 if all keys are distinct
+};
+
+static struct algo_space const algo_spaces[] = {
+        [1] = {0xff, 0xff, 0},  // Galois
+        [2] = {0xff, 0xff, 0},  // Fibonacci
+        [3] = {0x00, 0xff, 15}, // Fletcher
+        [4] = {0xff, 0xff, 0},  // Shift16
+};
+
+/// Check if the key is the canonical one of all keys giving the same digests.
+__attribute__((always_inline))
+static inline int algo_key_distinct(int algo, unsigned key)
+{
+    unsigned mod = algo_spaces[algo].nibble_mod;
+    return !mod || ((key & 0xf) < mod && (key >> 4) < mod);
+}
+
+/// Number of distinct keys that are tried for each gen.
+static inline unsigned algo_key_count(int algo)
+{
+    unsigned mod = algo_spaces[algo].nibble_mod;
+    return mod ? mod * mod : algo_spaces[algo].key_max + 1;
+}
+
+static char const *const variant_names[32] = {
+        "Galois",
+        "Galois BYTE_REFLECT",
+        "Galois BIT_REFLECT",
+        "Galois BIT_REFLECT BYTE_REFLECT",
+        "Rev-Galois",
+        "Rev-Galois BYTE_REFLECT",
+        "Rev-Galois BIT_REFLECT",
+        "Rev-Galois BIT_REFLECT BYTE_REFLECT",
+        "Fibonacci",
+        "Fibonacci BYTE_REFLECT",
+        "Fibonacci BIT_REFLECT",
+        "Fibonacci BIT_REFLECT BYTE_REFLECT",
+        "Rev-Fibonacci",
+        "Rev-Fibonacci BYTE_REFLECT",
+        "Rev-Fibonacci BIT_REFLECT",
+        "Rev-Fibonacci BIT_REFLECT BYTE_REFLECT",
+        "Fletcher",
+        "Fletcher BYTE_REFLECT",
+        "Fletcher BIT_REFLECT",
+        "Fletcher BIT_REFLECT BYTE_REFLECT",
+        "Rev-Fletcher",
+        "Rev-Fletcher BYTE_REFLECT",
+        "Rev-Fletcher BIT_REFLECT",
+        "Rev-Fletcher BIT_REFLECT BYTE_REFLECT",
+        "Shift16",
+        "Shift16 BYTE_REFLECT",
+        "Shift16 BIT_REFLECT",
+        "Shift16 BIT_REFLECT BYTE_REFLECT",
+        "Rev-Shift16",
+        "Rev-Shift16 BYTE_REFLECT",
+        "Rev-Shift16 BIT_REFLECT",
+        "Rev-Shift16 BIT_REFLECT BYTE_REFLECT",
+};
+
+static char const *result_file = NULL;
+static int first_hit = 0;
+static uint32_t variant_mask = 0; // the code paths selected with --variant, all if none
+
+/// Select the code path named @p name, returns 0 on success.
+static int select_variant(char const *name)
+{
+    for (int v = 0; v < 32; ++v) {
+        if (!strcmp(name, variant_names[v])) {
+            variant_mask |= 1u << v;
+            return 0;
+        }
+    }
+    fprintf(stderr, "Unknown variant \"%s\", use one of:\n", name);
+    for (int v = 0; v < 32; ++v)
+        fprintf(stderr, "  %s\n", variant_names[v]);
+    return -1;
+}
+
+static char const *const combiner_names[INSTR_COMBINERS] = {"sum xor", "xor xor", "sum add", "xor add", "sum sub", "xor sub"};
+
+static inline int combiner_index(char const *combiner)
+{
+    int c = 0;
+    while (c < INSTR_COMBINERS - 1 && strcmp(combiner, combiner_names[c]))
+        ++c;
+    return c;
+}
+
+static void done(int variant, unsigned g, unsigned k, unsigned r, char const *combiner, unsigned matches, unsigned total)
+{
+    if (first_hit && job_cancel())
+        return; // another worker was first
+    INSTR_ADD(INSTR_SURVIVORS + combiner_index(combiner), 1);
+    struct result res = {matches, total, g, k, r, variant, combiner, variant_names[variant]};
+    result_add(&res);
+}
+
+static void print_results(void)
+{
+    for (unsigned j = 0; j < result_len; ++j) {
+        struct result const *r = &result_list[j];
+        printf("Done with g %02x k %02x final XOR %02x using %s (%s, %.0f %%)\n",
+                r->gen, r->key, r->final, r->combiner, r->variant_name, 100.0 * r->matches / r->total);
+    }
+}
+
+// the code path index follows the order in job_run()
+#define DONE(msg, r, n) done((algo - 1) * 8 + rev * 4 + i_rev * 2 + y_rev, g, k, r, msg, n, list_len - 1)
+
+// the generators of each code path are split into this many jobs
+#define GEN_TILES 16
 
 static struct data data[LIST_MAX];
+static struct msg_matrix msgs;
 static unsigned msg_len  = 0;
 static unsigned list_len = 0;
 static unsigned min_matches = 0;
+static int solve_linear = 0;
+
+/*
+The keys of each gen are solved for over GF(2), see gf2.h.
+If the messages are not fully consistent the keys are scored using the linear map instead.
+*/
+
+static uint16_t chk_wide[LIST_MAX]; // the checksums of msgs, widened for gf2.h
 
 __attribute__((always_inline))
-static inline void *runner(int algo, int y_rev, int i_rev, int rev)
+static inline void *solver(int algo, int y_rev, int i_rev, int rev, unsigned g_min, unsigned g_max)
 {
-    for (unsigned g = 0; g <= 0xff; ++g) {
+    // linear map from key bits to digest bits, one column per key bit for each message
+    uint16_t *cols = malloc(list_len * 8 * sizeof(*cols));
+    if (!cols) {
+        perror("solver malloc");
+        exit(1);
+    }
+
+    // the keys are counted as candidates by runner_sliced(), which also runs on these gens
+    for (unsigned g = g_min; g <= g_max && !job_cancelled(); ++g) {
+        INSTR_ADD(INSTR_SCORED, list_len);
+        for (unsigned i = 0; i < list_len; ++i) {
+            for (unsigned b = 0; b < 8; ++b) {
+                uint8_t ds;
+                uint8_t dx;
+                call_algo(algo, y_rev, i_rev, rev, msgs.d[i], msg_len, g, 1 << b, &ds, &dx);
+                cols[i * 8 + b] = dx;
+            }
+        }
+
+        struct gf2_keys keys;
+        unsigned count = gf2_solve_keys(cols, chk_wide, 8, list_len, &keys);
+        int inconsistent = !count;
+        if (inconsistent)
+            count = 256;
+
+        for (unsigned n = 0; n < count; ++n) {
+            unsigned k = inconsistent ? n : gf2_key(&keys, n);
+
+            uint8_t rxx = gf2_digest(cols, 8, 0, k) ^ msgs.chk[0];
+
+            unsigned fxx = 0;
+            for (unsigned i = 1; i < list_len; ++i) {
+                fxx += rxx == (uint8_t)(gf2_digest(cols, 8, i, k) ^ msgs.chk[i]);
+            }
+
+            if (fxx >= min_matches) DONE("xor xor", rxx, fxx);
+        }
+    }
+
+    free(cols);
+    return NULL;
+}
+
+/*
+The Galois and Fibonacci LFSRs are evaluated bit-sliced, all 256 keys of a gen in one pass.
+Instead of the residuals themselves the differences to the first message are compared,
+e.g. ds + dc == rs + rc is equivalent to ds - rs == rc - dc.
+With skip_xor_xor the "xor xor" combiner is left to the solver.
+The variant is only known at runtime here, the digest is the specialized part and the keystream
+is computed once per gen, so there is a single instance instead of one for every variant.
+*/
+
+__attribute__((noinline))
+static void *runner_sliced(int algo, int y_rev, int i_rev, int rev, unsigned g_min, unsigned g_max, int skip_xor_xor)
+{
+    // number of counter planes to hold up to list_len - 1 matches
+    unsigned width = 1;
+    while ((1u << width) <= list_len)
+        width++;
+
+    digest8_sliced_fn digest = digest8_sliced_fns[y_rev][i_rev][msg_len];
+    if (!digest)
+        digest = digest8_sliced_any[y_rev][i_rev];
+
+    slice_t(*ks)[8] = malloc(msg_len * 8 * sizeof(*ks));
+    if (!ks) {
+        perror("runner_sliced malloc");
+        exit(1);
+    }
+
+    for (unsigned g = g_min; g <= g_max && !job_cancelled(); ++g) {
+        progress_add(algo_key_count(algo));
+        INSTR_ADD(INSTR_CANDIDATES, 256);
+        algo_keystream8_sliced(algo, rev, msg_len * 8, g, ks);
+
+        uint8_t const *rd = msgs.d[0];
+        uint8_t rc = msgs.chk[0];
+        slice_t rs[8];
+        slice_t rx[8];
+        digest(rd, msg_len, (slice_t const(*)[8])ks, rs, rx);
+
+        // match counters for sum xor, xor xor, sum add, xor add, sum sub, xor sub
+        slice_t cnt[6][17] = {{{0}}};
+
+        for (unsigned i = 1; i < list_len; ++i) {
+            uint8_t const *dd = msgs.d[i];
+            uint8_t dc = msgs.chk[i];
+            slice_t ds[8];
+            slice_t dx[8];
+            digest(dd, msg_len, (slice_t const(*)[8])ks, ds, dx);
+            INSTR_ADD(INSTR_SCORED, 256);
+
+            slice_t sx[8];
+            slice_t xx[8];
+            slice_t ss[8];
+            slice_t xs[8];
+            for (int j = 0; j < 8; ++j) {
+                sx[j] = ds[j] ^ rs[j];
+                xx[j] = dx[j] ^ rx[j];
+            }
+            slice_sub(ss, ds, rs, 8);
+            slice_sub(xs, dx, rx, 8);
+
+            uint8_t cx = dc ^ rc;
+            uint8_t ca = rc - dc;
+            uint8_t cs = dc - rc;
+            slice_inc(cnt[0], slice_eq(sx, cx, 8), width);
+            if (!skip_xor_xor)
+                slice_inc(cnt[1], slice_eq(xx, cx, 8), width);
+            slice_inc(cnt[2], slice_eq(ss, ca, 8), width);
+            slice_inc(cnt[3], slice_eq(xs, ca, 8), width);
+            slice_inc(cnt[4], slice_eq(ss, cs, 8), width);
+            slice_inc(cnt[5], slice_eq(xs, cs, 8), width);
+
+            // give up once no lane of any combiner can still reach min_matches
+            unsigned remaining = list_len - 1 - i;
+            if (min_matches > remaining) {
+                slice_t alive = slice_set(0);
+                for (int c = 0; c < 6; ++c) {
+                    if (c != 1 || !skip_xor_xor)
+                        alive |= slice_ge(cnt[c], min_matches - remaining, width);
+                }
+                if (!slice_any(alive))
+                    break;
+            }
+        }
+
+        slice_t hit[6];
+        slice_t any = slice_set(0);
+        for (int c = 0; c < 6; ++c) {
+            hit[c] = c != 1 || !skip_xor_xor ? slice_ge(cnt[c], min_matches, width) : slice_set(0);
+            any |= hit[c];
+        }
+        if (!slice_any(any))
+            continue;
+
         for (unsigned k = 0; k <= 0xff; ++k) {
-            struct data rd = data[0];
+            if (!slice_lane(any, k))
+                continue;
+            uint8_t rsv = slice_value(rs, k, 8);
+            uint8_t rxv = slice_value(rx, k, 8);
+            uint8_t rsx = rsv ^ rc;
+            uint8_t rxx = rxv ^ rc;
+            uint8_t rsa = rsv + rc;
+            uint8_t rxa = rxv + rc;
+            uint8_t rss = rsv - rc;
+            uint8_t rxs = rxv - rc;
+
+            if (slice_lane(hit[0], k)) DONE("sum xor", rsx, slice_value(cnt[0], k, width));
+            if (slice_lane(hit[1], k)) DONE("xor xor", rxx, slice_value(cnt[1], k, width));
+            if (slice_lane(hit[2], k)) DONE("sum add", rsa, slice_value(cnt[2], k, width));
+            if (slice_lane(hit[3], k)) DONE("xor add", rxa, slice_value(cnt[3], k, width));
+            if (slice_lane(hit[4], k)) DONE("sum sub", rss, slice_value(cnt[4], k, width));
+            if (slice_lane(hit[5], k)) DONE("xor sub", rxs, slice_value(cnt[5], k, width));
+        }
+    }
+
+    free(ks);
+    return NULL;
+}
+
+__attribute__((always_inline))
+static inline void *runner(int algo, int y_rev, int i_rev, int rev, unsigned g_min, unsigned g_max)
+{
+    // the LFSR digests run on all keys at once, the linear "xor xor" is solved directly if requested
+    if (algo == 1 || algo == 2) {
+        if (solve_linear)
+            solver(algo, y_rev, i_rev, rev, g_min, g_max);
+        return runner_sliced(algo, y_rev, i_rev, rev, g_min, g_max, solve_linear);
+    }
+
+    // the LFSR keystream is shared by all messages
+    int keyed = algo == 4;
+    uint8_t ks[MSG_MAX * 8];
+
+    if (g_max > algo_spaces[algo].gen_max)
+        g_max = algo_spaces[algo].gen_max;
+
+    for (unsigned g = g_min; g <= g_max && !job_cancelled(); ++g) {
+        progress_add(algo_key_count(algo));
+        for (unsigned k = 0; k <= algo_spaces[algo].key_max; ++k) {
+            if (!algo_key_distinct(algo, k))
+                continue;
+            if (keyed)
+                algo_keystream8(algo, rev, msg_len * 8, g, k, ks);
+            INSTR_ADD(INSTR_CANDIDATES, 1);
+
+            uint8_t const *rd = msgs.d[0];
+            uint8_t rc = msgs.chk[0];
             uint8_t rs;
             uint8_t rx;
-            call_algo(algo, y_rev, i_rev, rev, rd.d, msg_len, g, k, &rs, &rx);
-            uint8_t rsx = rs ^ rd.chk;
-            uint8_t rxx = rx ^ rd.chk;
-            uint8_t rsa = rs + rd.chk;
-            uint8_t rxa = rx + rd.chk;
-            uint8_t rss = rs - rd.chk;
-            uint8_t rxs = rx - rd.chk;
-            //printf("g %02x k %02x chk %02x rsx: %02x rxx: %02x rsa: %02x rxa: %02x rss: %02x rxs: %02x\n", g, k, rd.chk, rsx, rxx, rsa, rxa, rss, rxs);
+            if (keyed)
+                algo_keystream_digest8(y_rev, i_rev, rd, msg_len, ks, &rs, &rx);
+            else
+                call_algo(algo, y_rev, i_rev, rev, rd, msg_len, g, k, &rs, &rx);
+            uint8_t rsx = rs ^ rc;
+            uint8_t rxx = rx ^ rc;
+            uint8_t rsa = rs + rc;
+            uint8_t rxa = rx + rc;
+            uint8_t rss = rs - rc;
+            uint8_t rxs = rx - rc;
+            //printf("g %02x k %02x chk %02x rsx: %02x rxx: %02x rsa: %02x rxa: %02x rss: %02x rxs: %02x\n", g, k, rc, rsx, rxx, rsa, rxa, rss, rxs);
             //printf("rsx: %02x rxx: %02x rsa: %02x rxa: %02x rss: %02x rxs: %02x\n", rsx, rxx, rsa, rxa, rss, rxs);
 
             unsigned fsx = 0;
@@ -362,16 +889,21 @@ static inline void *runner(int algo, int y_rev, int i_rev, int rev)
             unsigned fxs = 0;
 
             for (unsigned i = 1; i < list_len; ++i) {
-                struct data dd = data[i];
+                uint8_t const *dd = msgs.d[i];
+                uint8_t dc = msgs.chk[i];
                 uint8_t ds;
                 uint8_t dx;
-                call_algo(algo, y_rev, i_rev, rev, dd.d, msg_len, g, k, &ds, &dx);
-                uint8_t dsx = ds ^ dd.chk;
-                uint8_t dxx = dx ^ dd.chk;
-                uint8_t dsa = ds + dd.chk;
-                uint8_t dxa = dx + dd.chk;
-                uint8_t dss = ds - dd.chk;
-                uint8_t dxs = dx - dd.chk;
+                if (keyed)
+                    algo_keystream_digest8(y_rev, i_rev, dd, msg_len, ks, &ds, &dx);
+                else
+                    call_algo(algo, y_rev, i_rev, rev, dd, msg_len, g, k, &ds, &dx);
+                INSTR_ADD(INSTR_SCORED, 1);
+                uint8_t dsx = ds ^ dc;
+                uint8_t dxx = dx ^ dc;
+                uint8_t dsa = ds + dc;
+                uint8_t dxa = dx + dc;
+                uint8_t dss = ds - dc;
+                uint8_t dxs = dx - dc;
                 //printf("dsx: %02x dxx: %02x dsa: %02x dxa: %02x dss: %02x dxs: %02x\n", dsx, dxx, dsa, dxa, dss, dxs);
 
                 fsx += rsx == dsx;
@@ -380,95 +912,135 @@ static inline void *runner(int algo, int y_rev, int i_rev, int rev)
                 fxa += rxa == dxa;
                 fss += rss == dss;
                 fxs += rxs == dxs;
+
+                // give up once no combiner can still reach min_matches
+                unsigned remaining = list_len - 1 - i;
+                if (fsx + remaining < min_matches && fxx + remaining < min_matches
+                        && fsa + remaining < min_matches && fxa + remaining < min_matches
+                        && fss + remaining < min_matches && fxs + remaining < min_matches)
+                    break;
             }
 
-            if (fsx >= min_matches) DONE("sum xor", rsx, 100.0 * fsx / (list_len - 1));
-            if (fsx >= min_matches) DONE("sum xor", rsx, 100.0 * fsx / (list_len - 1));
-            if (fxx >= min_matches) DONE("xor xor", rxx, 100.0 * fxx / (list_len - 1));
-            if (fsa >= min_matches) DONE("sum add", rsa, 100.0 * fsa / (list_len - 1));
-            if (fxa >= min_matches) DONE("xor add", rxa, 100.0 * fxa / (list_len - 1));
-            if (fss >= min_matches) DONE("sum sub", rss, 100.0 * fss / (list_len - 1));
-            if (fxs >= min_matches) DONE("xor sub", rxs, 100.0 * fxs / (list_len - 1));
+            if (fsx >= min_matches) DONE("sum xor", rsx, fsx);
+            if (fxx >= min_matches) DONE("xor xor", rxx, fxx);
+            if (fsa >= min_matches) DONE("sum add", rsa, fsa);
+            if (fxa >= min_matches) DONE("xor add", rxa, fxa);
+            if (fss >= min_matches) DONE("sum sub", rss, fss);
+            if (fxs >= min_matches) DONE("xor sub", rxs, fxs);
         }
     }
 
     return NULL;
 }
 
-static int job_run(int job_num)
+// number of generator ranges for a code path, 8 code paths per algorithm
+static int job_tiles(int variant)
 {
+    if (variant_mask && !(variant_mask >> variant & 1))
+        return 0;
+    unsigned gens = algo_spaces[variant / 8 + 1].gen_max + 1;
+    return gens < GEN_TILES ? gens : GEN_TILES;
+}
+
+// the timing of each code path, all are printed even if --first cancels some
+static struct measure_tiles variant_timing[32];
+
+static int job_total(void)
+{
+    int count = 0;
+    for (int v = 0; v < 32; ++v)
+        count += job_tiles(v);
+    return count;
+}
+
+static void job_run(void *ctx, int job_num)
+{
+    (void)ctx;
+
+    // each job is a range of generators for one code path
+    int variant = 0;
+    int first   = 0; // the first job of the code path
+    while (variant < 32 && job_num >= first + job_tiles(variant))
+        first += job_tiles(variant++);
+    if (variant >= 32)
+        return;
+    job_num -= first;
+    unsigned gens  = algo_spaces[variant / 8 + 1].gen_max + 1;
+    unsigned g_min = job_num * gens / job_tiles(variant);
+    unsigned g_max = (job_num + 1) * gens / job_tiles(variant) - 1;
+    // the timing of a code path is printed once all of its tiles in this shard are done
+    int tiles = job_shard_range(first, job_tiles(variant));
+
     // unroll every code path
-    if (job_num == 0)
-        MEASURE("Galois ", runner(1, 0, 0, 0););
-    else if (job_num == 1)
-        MEASURE("Galois BYTE_REFLECT", runner(1, 1, 0, 0););
-    else if (job_num == 2)
-        MEASURE("Galois BIT_REFLECT", runner(1, 0, 1, 0););
-    else if (job_num == 3)
-        MEASURE("Galois BIT_REFLECT BYTE_REFLECT", runner(1, 1, 1, 0););
-    else if (job_num == 4)
-        MEASURE("Rev-Galois ", runner(1, 0, 0, 1););
-    else if (job_num == 5)
-        MEASURE("Rev-Galois BYTE_REFLECT", runner(1, 1, 0, 1););
-    else if (job_num == 6)
-        MEASURE("Rev-Galois BIT_REFLECT", runner(1, 0, 1, 1););
-    else if (job_num == 7)
-        MEASURE("Rev-Galois BIT_REFLECT BYTE_REFLECT", runner(1, 1, 1, 1););
-
-    else if (job_num == 8)
-        MEASURE("Fibonacci ", runner(2, 0, 0, 0););
-    else if (job_num == 9)
-        MEASURE("Fibonacci BYTE_REFLECT", runner(2, 1, 0, 0););
-    else if (job_num == 10)
-        MEASURE("Fibonacci BIT_REFLECT", runner(2, 0, 1, 0););
-    else if (job_num == 11)
-        MEASURE("Fibonacci BIT_REFLECT BYTE_REFLECT", runner(2, 1, 1, 0););
-    else if (job_num == 12)
-        MEASURE("Rev-Fibonacci ", runner(2, 0, 0, 1););
-    else if (job_num == 13)
-        MEASURE("Rev-Fibonacci BYTE_REFLECT", runner(2, 1, 0, 1););
-    else if (job_num == 14)
-        MEASURE("Rev-Fibonacci BIT_REFLECT", runner(2, 0, 1, 1););
-    else if (job_num == 15)
-        MEASURE("Rev-Fibonacci BIT_REFLECT BYTE_REFLECT", runner(2, 1, 1, 1););
-
-    else if (job_num == 16)
-        MEASURE("Fletcher ", runner(3, 0, 0, 0););
-    else if (job_num == 17)
-        MEASURE("Fletcher BYTE_REFLECT", runner(3, 1, 0, 0););
-    else if (job_num == 18)
-        MEASURE("Fletcher BIT_REFLECT", runner(3, 0, 1, 0););
-    else if (job_num == 19)
-        MEASURE("Fletcher BIT_REFLECT BYTE_REFLECT", runner(3, 1, 1, 0););
-    else if (job_num == 20)
-        MEASURE("Rev-Fletcher ", runner(3, 0, 0, 1););
-    else if (job_num == 21)
-        MEASURE("Rev-Fletcher BYTE_REFLECT", runner(3, 1, 0, 1););
-    else if (job_num == 22)
-        MEASURE("Rev-Fletcher BIT_REFLECT", runner(3, 0, 1, 1););
-    else if (job_num == 23)
-        MEASURE("Rev-Fletcher BIT_REFLECT BYTE_REFLECT", runner(3, 1, 1, 1););
-
-    else if (job_num == 24)
-        MEASURE("Shift16 ", runner(4, 0, 0, 0););
-    else if (job_num == 25)
-        MEASURE("Shift16 BYTE_REFLECT", runner(4, 1, 0, 0););
-    else if (job_num == 26)
-        MEASURE("Shift16 BIT_REFLECT", runner(4, 0, 1, 0););
-    else if (job_num == 27)
-        MEASURE("Shift16 BIT_REFLECT BYTE_REFLECT", runner(4, 1, 1, 0););
-    else if (job_num == 28)
-        MEASURE("Rev-Shift16 ", runner(4, 0, 0, 1););
-    else if (job_num == 29)
-        MEASURE("Rev-Shift16 BYTE_REFLECT", runner(4, 1, 0, 1););
-    else if (job_num == 30)
-        MEASURE("Rev-Shift16 BIT_REFLECT", runner(4, 0, 1, 1););
-    else if (job_num == 31)
-        MEASURE("Rev-Shift16 BIT_REFLECT BYTE_REFLECT", runner(4, 1, 1, 1););
+    if (variant == 0)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 0, 0, 0, g_min, g_max););
+    else if (variant == 1)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 1, 0, 0, g_min, g_max););
+    else if (variant == 2)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 0, 1, 0, g_min, g_max););
+    else if (variant == 3)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 1, 1, 0, g_min, g_max););
+    else if (variant == 4)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 0, 0, 1, g_min, g_max););
+    else if (variant == 5)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 1, 0, 1, g_min, g_max););
+    else if (variant == 6)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 0, 1, 1, g_min, g_max););
+    else if (variant == 7)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(1, 1, 1, 1, g_min, g_max););
+
+    else if (variant == 8)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 0, 0, 0, g_min, g_max););
+    else if (variant == 9)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 1, 0, 0, g_min, g_max););
+    else if (variant == 10)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 0, 1, 0, g_min, g_max););
+    else if (variant == 11)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 1, 1, 0, g_min, g_max););
+    else if (variant == 12)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 0, 0, 1, g_min, g_max););
+    else if (variant == 13)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 1, 0, 1, g_min, g_max););
+    else if (variant == 14)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 0, 1, 1, g_min, g_max););
+    else if (variant == 15)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(2, 1, 1, 1, g_min, g_max););
+
+    else if (variant == 16)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 0, 0, 0, g_min, g_max););
+    else if (variant == 17)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 1, 0, 0, g_min, g_max););
+    else if (variant == 18)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 0, 1, 0, g_min, g_max););
+    else if (variant == 19)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 1, 1, 0, g_min, g_max););
+    else if (variant == 20)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 0, 0, 1, g_min, g_max););
+    else if (variant == 21)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 1, 0, 1, g_min, g_max););
+    else if (variant == 22)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 0, 1, 1, g_min, g_max););
+    else if (variant == 23)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(3, 1, 1, 1, g_min, g_max););
+
+    else if (variant == 24)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 0, 0, 0, g_min, g_max););
+    else if (variant == 25)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 1, 0, 0, g_min, g_max););
+    else if (variant == 26)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 0, 1, 0, g_min, g_max););
+    else if (variant == 27)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 1, 1, 0, g_min, g_max););
+    else if (variant == 28)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 0, 0, 1, g_min, g_max););
+    else if (variant == 29)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 1, 0, 1, g_min, g_max););
+    else if (variant == 30)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 0, 1, 1, g_min, g_max););
+    else if (variant == 31)
+        MEASURE_TILES_AT(&variant_timing[variant], tiles, variant_names[variant], runner(4, 1, 1, 1, g_min, g_max););
     else
         {}
-
-    return 32;
 }
 
 // e.g. Ambient Weather F007TH Thermo-Hygrometer
@@ -478,7 +1050,7 @@ __attribute__((noreturn))
 static void usage(int argc, char const *argv[])
 {
     (void)argc;
-    fprintf(stderr, "%s: [-v] [-s|-p] codes.txt\n", argv[0]);
+    fprintf(stderr, "%s: [-v] [-s|-p [threads] [--pin]] [--progress secs] [--variant name...] [-l] [--first] [--shard i/n] [-o results.txt] codes.txt\n", argv[0]);
     exit(1);
 }
 
@@ -488,20 +1060,45 @@ int main(int argc, char const *argv[])
 
     int verbose = 0;
     int parallel = 0;
+    int threads  = 0;
+    int pin      = 0;
     double min_matches_pct = 0.8;
 
     int i = 1;
     for (; i < argc; ++i) {
         if (*argv[i] != '-')
             break;
-        if (argv[i][1] == 'h')
+        if (!strcmp(argv[i], "--shard")) {
+            if (job_parse_shard(i + 1 < argc ? argv[++i] : NULL))
+                usage(argc, argv);
+        }
+        else if (!strcmp(argv[i], "--first"))
+            first_hit = 1;
+        else if (!strcmp(argv[i], "--pin"))
+            pin = 1;
+        else if (!strcmp(argv[i], "--progress") && i + 1 < argc)
+            job_progress(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--variant")) {
+            if (select_variant(i + 1 < argc ? argv[++i] : ""))
+                usage(argc, argv);
+        }
+        else if (argv[i][1] == 'h')
             usage(argc, argv);
         else if (argv[i][1] == 'v')
             verbose++;
+        else if (argv[i][1] == 'o' && i + 1 < argc)
+            result_file = argv[++i];
         else if (argv[i][1] == 's')
             parallel = 0;
-        else if (argv[i][1] == 'p')
+        else if (argv[i][1] == 'p') {
             parallel = 1;
+            if (argv[i][2])
+                threads = atoi(&argv[i][2]);
+            else if (i + 2 < argc && *argv[i + 1] >= '0' && *argv[i + 1] <= '9')
+                threads = atoi(argv[++i]);
+        }
+        else if (argv[i][1] == 'l')
+            solve_linear = 1;
         else {
             fprintf(stderr, "Wrong argument (%s).\n", argv[i]);
             usage(argc, argv);
@@ -526,12 +1123,38 @@ int main(int argc, char const *argv[])
 
     fprintf(stderr, "Processing...\n");
     min_matches = list_len * min_matches_pct;
+    if (msg_matrix_init(&msgs, data, msg_len, list_len) < 0)
+        exit(1);
     msg_len -= 1; // use 8-bit chk
+    for (unsigned j = 0; j < list_len; ++j) {
+        chk_wide[j] = msgs.chk[j];
+    }
 
+    for (int v = 0, first = 0; v < 32; first += job_tiles(v++)) {
+        int tiles = job_shard_range(first, job_tiles(v));
+        if (tiles)
+            measure_tiles_init(&variant_timing[v], tiles, variant_names[v]);
+    }
     if (parallel)
-        job_exec_parallel(job_run, 0);
+        job_exec_parallel(job_run, NULL, job_total(), threads, pin);
     else
-        job_exec_sequential(job_run);
+        job_exec_sequential(job_run, NULL, job_total());
+    measure_tiles_flush(); // code paths cut short by --first
+
+    result_collect();
+    print_results();
+    if (result_file) {
+        char header[128];
+        int len = snprintf(header, sizeof(header), "revdgst shard %d/%d of %u codes %08x",
+                job_shard_index + 1, job_shard_count, list_len, msg_matrix_hash(&msgs));
+        if (variant_mask)
+            snprintf(header + len, sizeof(header) - len, " variants %08x", variant_mask);
+        if (result_write(result_file, header))
+            exit(1);
+    }
+    result_free();
+
+    msg_matrix_free(&msgs);
 
     print_runtimes();
 }
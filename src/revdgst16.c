@@ -12,26 +12,50 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "intrinsic.h"
 #include "util.h"
+#include "gf2.h"
 #include "measure.h"
 #include "codes.h"
+#include "result.h"
+#include "checkpoint.h"
 
 #include "job.h"
 
 /*
 Modify this algorithm to test other possible checksum methods.
+
+Note that the reversing arguments will be expanded and optimized away when unrolling every code path.
+Unlike revdgst the bits are consumed MSB first by default, BIT_REFLECT consumes them LSB first.
 */
 
 __attribute__((always_inline))
-static inline void algo_lfsr_digest16(uint8_t *msg, unsigned bytes, uint16_t gen, uint16_t key, uint16_t *sum, uint16_t *xor)
+static inline void algo_lfsr_digest16(int algo, int y_rev, int i_rev, int rev,
+        uint8_t const *msg, unsigned bytes, uint16_t gen, uint16_t key, uint16_t *sum, uint16_t *xor)
 {
+    // all this will be optimized away
+    int y_min, y_max, y_step;
+    if (y_rev) {
+        y_min = bytes - 1; y_max = -1; y_step = -1;
+    } else {
+        y_min = 0; y_max = bytes; y_step = 1;
+    }
+
+    int i_min, i_max, i_step;
+    if (i_rev) {
+        i_min = 0; i_max = 8; i_step = 1;
+    }
+    else {
+        i_min = 7; i_max = -1; i_step = -1;
+    }
+
     *sum = 0;
     *xor = 0;
-    for (unsigned k = 0; k < bytes; ++k) {
+    for (int k = y_min; k != y_max; k += y_step) {
         uint8_t data = msg[k];
-        for (int bit = 7; bit >= 0; --bit) {
+        for (int bit = i_min; bit != i_max; bit += i_step) {
             // fprintf(stderr, "key at bit %d : %04x\n", bit, key);
             // if data bit is set then xor with key
             if ((data >> bit) & 1) {
@@ -39,103 +63,495 @@ static inline void algo_lfsr_digest16(uint8_t *msg, unsigned bytes, uint16_t gen
                 *xor ^= key;
             }
 
-            // roll the key right (actually the lsb is dropped here)
-            // and apply the gen (needs to include the dropped lsb as msb)
-            if (key & 1)
-                key = (key >> 1) ^ gen;
-            else
-                key = (key >> 1);
-
-            // equivalent but slower on O3:
-            // key = (key >> 1) ^ ((-(key & 1)) & gen);
-            // also slower:
-            // key = (key >> 1) ^ ((key & 1) * gen);
-
-            // -or- (Fibonacci LFSR)
-            //if (parity(key & gen))
-            //    key = (key >> 1) | (1 << 15);
-            //else
-            //    key = (key >> 1);
+            if (algo == 1) {
+                // - Galois LFSR -
+                // roll the key right (actually the lsb is dropped here)
+                // and apply the gen (needs to include the dropped lsb as msb)
+                if (rev) {
+                    if (key & 0x8000)
+                        key = (key << 1) ^ gen;
+                    else
+                        key = (key << 1);
+                }
+                else {
+                    if (key & 1)
+                        key = (key >> 1) ^ gen;
+                    else
+                        key = (key >> 1);
+                }
+
+                // equivalent but slower on O3:
+                // key = (key >> 1) ^ ((-(key & 1)) & gen);
+                // also slower:
+                // key = (key >> 1) ^ ((key & 1) * gen);
+            }
+            else {
+                // - Fibonacci LFSR -
+                // shift the key right (not roll, the lsb is dropped)
+                // and set the msb to the parity of key and gen (needs to include lsb)
+                if (rev) {
+                    if (parity(key & gen))
+                        key = (key << 1) | (1 << 0);
+                    else
+                        key = (key << 1);
+                }
+                else {
+                    if (parity(key & gen))
+                        key = (key >> 1) | (1 << 15);
+                    else
+                        key = (key >> 1);
+                }
+            }
         }
     }
 }
 
-#define DONE(fin, msg) do { ++found; printf("Done with g %04x k %04x final %04x using %s\n", g, k, fin, msg); } while (0)
+/// The n-th of the 32768 generators of a variant, the LFSR always taps the bit that is shifted out.
+__attribute__((always_inline))
+static inline uint16_t gen16(int algo, int rev, unsigned n)
+{
+    if ((algo == 1) != rev)
+        return 0x8000 | n;
+    else
+        return (n << 1) | 1;
+}
+
+#define DONE(fin, msg, e) done(variant, e, g, k, fin, msg)
 
 static struct data data[LIST_MAX];
+static struct msg_matrix msgs;
 static unsigned msg_len  = 0;
 static unsigned list_len = 0;
 
-static int found = 0;
-static int numofthreads = 1;
+static int first_hit = 0;
+static int solve_linear = 0;
+static int gray_keys = 0;
+
+#define VARIANT16_COUNT 16
+#define GEN16_TILES 64
+
+static char const *const variant16_names[VARIANT16_COUNT] = {
+        "Galois",
+        "Galois BYTE_REFLECT",
+        "Galois BIT_REFLECT",
+        "Galois BIT_REFLECT BYTE_REFLECT",
+        "Rev-Galois",
+        "Rev-Galois BYTE_REFLECT",
+        "Rev-Galois BIT_REFLECT",
+        "Rev-Galois BIT_REFLECT BYTE_REFLECT",
+        "Fibonacci",
+        "Fibonacci BYTE_REFLECT",
+        "Fibonacci BIT_REFLECT",
+        "Fibonacci BIT_REFLECT BYTE_REFLECT",
+        "Rev-Fibonacci",
+        "Rev-Fibonacci BYTE_REFLECT",
+        "Rev-Fibonacci BIT_REFLECT",
+        "Rev-Fibonacci BIT_REFLECT BYTE_REFLECT",
+};
+
+/*
+Each variant takes 2^31 keys and gens, by default only the plain Galois variant is searched.
+Use -a for all variants or --variant to select some, the jobs cover the selected variants only.
+*/
+
+static int variant16_list[VARIANT16_COUNT] = {0}; // the selected variants, in order
+static int variant16_list_len = 0;
+
+/// Select the variant named @p name, returns 0 on success.
+static int select_variant(char const *name)
+{
+    for (int v = 0; v < VARIANT16_COUNT; ++v) {
+        if (strcmp(name, variant16_names[v]))
+            continue;
+        for (int j = 0; j < variant16_list_len; ++j) {
+            if (variant16_list[j] == v)
+                return 0; // already selected
+        }
+        variant16_list[variant16_list_len++] = v;
+        return 0;
+    }
+    fprintf(stderr, "Unknown variant \"%s\", use one of:\n", name);
+    for (int v = 0; v < VARIANT16_COUNT; ++v)
+        fprintf(stderr, "  %s\n", variant16_names[v]);
+    return -1;
+}
+
+/*
+Every digest is checked against all checksum encodings in the same sweep,
+i.e. the checksum as read and byte swapped.
+*/
+
+#define CHK_ENCODINGS 2
+
+static uint16_t chk16_swapped[LIST_MAX];
+static uint16_t const *chk16_enc[CHK_ENCODINGS] = {NULL, chk16_swapped};
+static char const *const chk16_enc_names[CHK_ENCODINGS] = {"", ", byte swapped"};
+
+static char const *result_file = NULL;
+static char const *checkpoint_file = NULL;
+static char variant16_labels[VARIANT16_COUNT * CHK_ENCODINGS][64];
+
+static char const *const combiner16_names[INSTR_COMBINERS] = {"sum xor", "xor xor", "sum add", "xor add", "sum sub", "xor sub"};
+
+static inline int combiner16_index(char const *combiner)
+{
+    int c = 0;
+    while (c < INSTR_COMBINERS - 1 && strcmp(combiner, combiner16_names[c]))
+        ++c;
+    return c;
+}
+
+static void report(int variant, int e, unsigned g, unsigned k, unsigned fin, char const *combiner, int restored)
+{
+    if (first_hit && job_cancel() && !restored)
+        return; // another worker was first
+    if (!restored)
+        INSTR_ADD(INSTR_SURVIVORS + combiner16_index(combiner), 1);
+    int label = variant * CHK_ENCODINGS + e;
+    struct result res = {list_len - 1, list_len - 1, g, k, fin, label, combiner, variant16_labels[label]};
+    result_add(&res);
+    if (!restored)
+        checkpoint_result(&res);
+}
 
-static int runner(int offset)
+static void print_results(void)
 {
-    if (offset < 0 || offset > numofthreads)
-        return numofthreads;
-    int step = numofthreads;
+    for (unsigned j = 0; j < result_len; ++j) {
+        struct result const *r = &result_list[j];
+        printf("Done with g %04x k %04x final %04x using %s (%s)\n",
+                r->gen, r->key, r->final, r->combiner, r->variant_name);
+    }
+}
+
+static void done(int variant, int e, unsigned g, unsigned k, unsigned fin, char const *combiner)
+{
+    report(variant, e, g, k, fin, combiner, 0);
+}
+
+/// Report a result from a checkpoint again, mapping the names back to our static strings.
+static void restore(struct result const *r)
+{
+    for (int label = 0; label < VARIANT16_COUNT * CHK_ENCODINGS; ++label) {
+        if (strcmp(r->variant_name, variant16_labels[label]))
+            continue;
+        for (unsigned c = 0; c < INSTR_COMBINERS; ++c) {
+            if (!strcmp(r->combiner, combiner16_names[c])) {
+                report(label / CHK_ENCODINGS, label % CHK_ENCODINGS, r->gen, r->key, r->final, combiner16_names[c], 1);
+                return;
+            }
+        }
+    }
+    fprintf(stderr, "Unknown result in checkpoint: %s (%s)\n", r->combiner, r->variant_name);
+}
+
+/*
+With -l the "xor xor" combiner is left to the solver, the other combiners are still tried on all keys.
+*/
 
-    for (unsigned g=0x8000 + offset; !found && g <= 0xffff; g += step) {
+__attribute__((always_inline))
+static inline void runner_len(int algo, int y_rev, int i_rev, int rev, int variant,
+        unsigned n_min, unsigned n_max, unsigned len)
+{
+    int const xor_xor = !solve_linear;
+    for (unsigned n = n_min; n <= n_max && !job_cancelled(); ++n) {
+        progress_add(0x10000);
+        INSTR_ADD(INSTR_CANDIDATES, 0x10000);
+        unsigned g = gen16(algo, rev, n);
         for (unsigned k = 0; k <= 0xffff; ++k) {
-            struct data rd = data[0];
+            uint8_t const *rd = msgs.d[0];
             uint16_t rs;
             uint16_t rx;
-            algo_lfsr_digest16(rd.d, msg_len, g, k, &rs, &rx);
-            uint16_t rsx = rs ^ rd.chk16;
-            uint16_t rxx = rx ^ rd.chk16;
-            uint16_t rsa = rs + rd.chk16;
-            uint16_t rxa = rx + rd.chk16;
-            uint16_t rss = rs - rd.chk16;
-            uint16_t rxs = rx - rd.chk16;
-            //printf("g %04x k %04x chk %04x rsx: %04x rxx: %04x rsa: %04x rxa: %04x rss: %04x rxs: %04x\n", g, k, rd.chk16, rsx, rxx, rsa, rxa, rss, rxs);
-            //printf("rsx: %04x rxx: %04x rsa: %04x rxa: %04x rss: %04x rxs: %04x\n", rsx, rxx, rsa, rxa, rss, rxs);
-
-            int fsx = 1;
-            int fxx = 1;
-            int fsa = 1;
-            int fxa = 1;
-            int fss = 1;
-            int fxs = 1;
+            algo_lfsr_digest16(algo, y_rev, i_rev, rev, rd, len, g, k, &rs, &rx);
+            INSTR_ADD(INSTR_SCORED, 1);
+
+            uint16_t rsx[CHK_ENCODINGS];
+            uint16_t rxx[CHK_ENCODINGS];
+            uint16_t rsa[CHK_ENCODINGS];
+            uint16_t rxa[CHK_ENCODINGS];
+            uint16_t rss[CHK_ENCODINGS];
+            uint16_t rxs[CHK_ENCODINGS];
+            int fsx[CHK_ENCODINGS];
+            int fxx[CHK_ENCODINGS];
+            int fsa[CHK_ENCODINGS];
+            int fxa[CHK_ENCODINGS];
+            int fss[CHK_ENCODINGS];
+            int fxs[CHK_ENCODINGS];
+            for (int e = 0; e < CHK_ENCODINGS; ++e) {
+                uint16_t rc = chk16_enc[e][0];
+                rsx[e] = rs ^ rc;
+                rxx[e] = rx ^ rc;
+                rsa[e] = rs + rc;
+                rxa[e] = rx + rc;
+                rss[e] = rs - rc;
+                rxs[e] = rx - rc;
+                fsx[e] = fsa[e] = fxa[e] = fss[e] = fxs[e] = 1;
+                fxx[e] = xor_xor;
+            }
 
             for (unsigned i = 1; i < list_len; ++i) {
-                struct data dd = data[i];
+                uint8_t const *dd = msgs.d[i];
                 uint16_t ds;
                 uint16_t dx;
-                algo_lfsr_digest16(dd.d, msg_len, g, k, &ds, &dx);
-                uint16_t dsx = ds ^ dd.chk16;
-                uint16_t dxx = dx ^ dd.chk16;
-                uint16_t dsa = ds + dd.chk16;
-                uint16_t dxa = dx + dd.chk16;
-                uint16_t dss = ds - dd.chk16;
-                uint16_t dxs = dx - dd.chk16;
-                //printf("dsx: %04x dxx: %04x dsa: %04x dxa: %04x dss: %04x dxs: %04x\n", dsx, dxx, dsa, dxa, dss, dxs);
-
-                fsx &= rsx == dsx;
-                fxx &= rxx == dxx;
-                fsa &= rsa == dsa;
-                fxa &= rxa == dxa;
-                fss &= rss == dss;
-                fxs &= rxs == dxs;
-
-                if (fsx || fxx || fsa || fxa || fss || fxs) {
-                    // still going
+                algo_lfsr_digest16(algo, y_rev, i_rev, rev, dd, len, g, k, &ds, &dx);
+                INSTR_ADD(INSTR_SCORED, 1);
+
+                int going = 0;
+                for (int e = 0; e < CHK_ENCODINGS; ++e) {
+                    uint16_t dc = chk16_enc[e][i];
+                    fsx[e] &= rsx[e] == (uint16_t)(ds ^ dc);
+                    fxx[e] &= rxx[e] == (uint16_t)(dx ^ dc);
+                    fsa[e] &= rsa[e] == (uint16_t)(ds + dc);
+                    fxa[e] &= rxa[e] == (uint16_t)(dx + dc);
+                    fss[e] &= rss[e] == (uint16_t)(ds - dc);
+                    fxs[e] &= rxs[e] == (uint16_t)(dx - dc);
+                    going |= fsx[e] | fxx[e] | fsa[e] | fxa[e] | fss[e] | fxs[e];
                 }
-                else {
-                    // give up
-                    break;
+
+                if (!going)
+                    break; // give up
+            }
+
+            for (int e = 0; e < CHK_ENCODINGS; ++e) {
+                if (fsx[e]) DONE(rsx[e], "sum xor", e);
+                if (fxx[e]) DONE(rxx[e], "xor xor", e);
+                if (fsa[e]) DONE(rsa[e], "sum add", e);
+                if (fxa[e]) DONE(rxa[e], "xor add", e);
+                if (fss[e]) DONE(rss[e], "sum sub", e);
+                if (fxs[e]) DONE(rxs[e], "xor sub", e);
+            }
+        }
+    }
+}
+
+/*
+The keys of each gen are solved for over GF(2), see gf2.h.
+Only the "xor xor" combiner is covered and, as with the brute force, all messages need to match.
+The brute force runs after it for the other combiners and counts the candidates.
+*/
+
+__attribute__((always_inline))
+static inline void solver_len(int algo, int y_rev, int i_rev, int rev, int variant,
+        unsigned n_min, unsigned n_max, unsigned len)
+{
+    // linear map from key bits to digest bits, one column per key bit for each message
+    uint16_t *cols = malloc(list_len * 16 * sizeof(*cols));
+    if (!cols) {
+        perror("solver malloc");
+        exit(1);
+    }
+
+    for (unsigned n = n_min; n <= n_max && !job_cancelled(); ++n) {
+        INSTR_ADD(INSTR_SCORED, list_len);
+        unsigned g = gen16(algo, rev, n);
+        for (unsigned i = 0; i < list_len; ++i) {
+            for (unsigned b = 0; b < 16; ++b) {
+                uint16_t ds;
+                algo_lfsr_digest16(algo, y_rev, i_rev, rev, msgs.d[i], len, g, 1 << b, &ds, &cols[i * 16 + b]);
+            }
+        }
+
+        for (int e = 0; e < CHK_ENCODINGS; ++e) {
+            struct gf2_keys keys;
+            unsigned count = gf2_solve_keys(cols, chk16_enc[e], 16, list_len, &keys);
+
+            for (unsigned m = 0; m < count; ++m) {
+                unsigned k = gf2_key(&keys, m);
+                uint16_t rxx = gf2_digest(cols, 16, 0, k) ^ chk16_enc[e][0];
+                DONE(rxx, "xor xor", e);
+            }
+        }
+    }
+
+    free(cols);
+}
+
+/*
+Since the xor digest is linear in the key, stepping the keys in Gray code order
+changes the digest of each message by the digest of the single key bit flipped.
+The digests of all messages are kept up to date with one XOR each per key.
+Only the combiners on the xor digest ("xor xor", "xor add", "xor sub") are covered.
+*/
+
+__attribute__((always_inline))
+static inline void gray_len(int algo, int y_rev, int i_rev, int rev, int variant,
+        unsigned n_min, unsigned n_max, unsigned len)
+{
+    // digest of each message for every single key bit, and the current digests
+    uint16_t *basis = malloc(16 * list_len * sizeof(*basis)); // by key bit, then message
+    uint16_t *dxs = malloc(list_len * sizeof(*dxs));
+    if (!basis || !dxs) {
+        perror("gray malloc");
+        exit(1);
+    }
+
+    for (unsigned n = n_min; n <= n_max && !job_cancelled(); ++n) {
+        progress_add(0x10000);
+        INSTR_ADD(INSTR_CANDIDATES, 0x10000);
+        unsigned g = gen16(algo, rev, n);
+        for (unsigned b = 0; b < 16; ++b) {
+            for (unsigned i = 0; i < list_len; ++i) {
+                uint16_t ds;
+                algo_lfsr_digest16(algo, y_rev, i_rev, rev, msgs.d[i], len, g, 1 << b, &ds, &basis[b * list_len + i]);
+            }
+        }
+        // the digest of key 0 is 0
+        for (unsigned i = 0; i < list_len; ++i) {
+            dxs[i] = 0;
+        }
+
+        unsigned k = 0;
+        for (unsigned m = 1; m <= 0x10000; ++m) {
+            uint16_t rxx[CHK_ENCODINGS];
+            uint16_t rxa[CHK_ENCODINGS];
+            uint16_t rxs[CHK_ENCODINGS];
+            int fxx[CHK_ENCODINGS];
+            int fxa[CHK_ENCODINGS];
+            int fxs[CHK_ENCODINGS];
+            for (int e = 0; e < CHK_ENCODINGS; ++e) {
+                uint16_t rc = chk16_enc[e][0];
+                rxx[e] = dxs[0] ^ rc;
+                rxa[e] = dxs[0] + rc;
+                rxs[e] = dxs[0] - rc;
+                fxx[e] = fxa[e] = fxs[e] = 1;
+            }
+            INSTR_ADD(INSTR_SCORED, 1);
+
+            for (unsigned i = 1; i < list_len; ++i) {
+                INSTR_ADD(INSTR_SCORED, 1);
+                int going = 0;
+                for (int e = 0; e < CHK_ENCODINGS; ++e) {
+                    uint16_t dc = chk16_enc[e][i];
+                    fxx[e] &= rxx[e] == (uint16_t)(dxs[i] ^ dc);
+                    fxa[e] &= rxa[e] == (uint16_t)(dxs[i] + dc);
+                    fxs[e] &= rxs[e] == (uint16_t)(dxs[i] - dc);
+                    going |= fxx[e] | fxa[e] | fxs[e];
                 }
+
+                if (!going)
+                    break; // give up
             }
 
-            if (fsx) DONE(rsx, "sum xor");
-            if (fxx) DONE(rxx, "xor xor");
-            if (fsa) DONE(rsa, "sum add");
-            if (fxa) DONE(rxa, "xor add");
-            if (fss) DONE(rss, "sum sub");
-            if (fxs) DONE(rxs, "xor sub");
+            for (int e = 0; e < CHK_ENCODINGS; ++e) {
+                if (fxx[e]) DONE(rxx[e], "xor xor", e);
+                if (fxa[e]) DONE(rxa[e], "xor add", e);
+                if (fxs[e]) DONE(rxs[e], "xor sub", e);
+            }
+
+            // next key in Gray code order
+            unsigned b = ctz(m);
+            if (b >= 16)
+                break;
+            k ^= 1u << b;
+            for (unsigned i = 0; i < list_len; ++i) {
+                dxs[i] ^= basis[b * list_len + i];
+            }
         }
     }
 
-    return numofthreads;
+    free(basis);
+    free(dxs);
+}
+
+/*
+The brute force of every variant is specialized for the common message lengths,
+with a fixed trip count the compiler fully unrolls the digest.
+Other lengths, the solver, and the Gray code enumeration use a generic instance per variant,
+they evaluate few digests per key.
+Each job is a range of generators for one variant, the instance is selected by msg_len.
+*/
+
+// expand X(len, variant, algo, y_rev, i_rev, rev) for every variant
+#define VARIANT16_EACH(X, len) \
+    X(len, 0, 1, 0, 0, 0) \
+    X(len, 1, 1, 1, 0, 0) \
+    X(len, 2, 1, 0, 1, 0) \
+    X(len, 3, 1, 1, 1, 0) \
+    X(len, 4, 1, 0, 0, 1) \
+    X(len, 5, 1, 1, 0, 1) \
+    X(len, 6, 1, 0, 1, 1) \
+    X(len, 7, 1, 1, 1, 1) \
+    X(len, 8, 2, 0, 0, 0) \
+    X(len, 9, 2, 1, 0, 0) \
+    X(len, 10, 2, 0, 1, 0) \
+    X(len, 11, 2, 1, 1, 0) \
+    X(len, 12, 2, 0, 0, 1) \
+    X(len, 13, 2, 1, 0, 1) \
+    X(len, 14, 2, 0, 1, 1) \
+    X(len, 15, 2, 1, 1, 1)
+
+typedef void (*kernel16_fn)(unsigned n_min, unsigned n_max);
+
+#define RUNNER16_FN(len, v, algo, y_rev, i_rev, rev) \
+    static void runner16_##v##_##len(unsigned n_min, unsigned n_max) \
+    { \
+        runner_len(algo, y_rev, i_rev, rev, v, n_min, n_max, len); \
+    }
+#define RUNNERS16(len) VARIANT16_EACH(RUNNER16_FN, len)
+MSG_LEN_COMMON(RUNNERS16)
+
+#define KERNEL16_ANY_FNS(len, v, algo, y_rev, i_rev, rev) \
+    static void runner16_##v##_any(unsigned n_min, unsigned n_max) \
+    { \
+        runner_len(algo, y_rev, i_rev, rev, v, n_min, n_max, msg_len); \
+    } \
+    static void solver16_##v(unsigned n_min, unsigned n_max) \
+    { \
+        solver_len(algo, y_rev, i_rev, rev, v, n_min, n_max, msg_len); \
+    } \
+    static void gray16_##v(unsigned n_min, unsigned n_max) \
+    { \
+        gray_len(algo, y_rev, i_rev, rev, v, n_min, n_max, msg_len); \
+    }
+VARIANT16_EACH(KERNEL16_ANY_FNS, any)
+
+struct kernel16 {
+    kernel16_fn runner; // for any length
+    kernel16_fn solver;
+    kernel16_fn gray;
+};
+
+#define KERNEL16_ENTRY(len, v, algo, y_rev, i_rev, rev) \
+    [v] = {runner16_##v##_any, solver16_##v, gray16_##v},
+static struct kernel16 const kernels16[VARIANT16_COUNT] = {VARIANT16_EACH(KERNEL16_ENTRY, any)};
+
+#define RUNNER16_ENTRY(len, v, algo, y_rev, i_rev, rev) \
+    [v][len] = runner16_##v##_##len,
+#define RUNNER16_ENTRIES(len) VARIANT16_EACH(RUNNER16_ENTRY, len)
+static kernel16_fn const runners16[VARIANT16_COUNT][MSG_MAX] = {MSG_LEN_COMMON(RUNNER16_ENTRIES)};
+
+// timing of each variant, summed over its tiles in this shard
+static struct measure_tiles variant16_timing[VARIANT16_COUNT];
+
+static void job_run(void *ctx, int job_num)
+{
+    (void)ctx;
+
+    if (checkpoint_done(job_num))
+        return;
+
+    int slot       = job_num / GEN16_TILES;
+    int variant    = variant16_list[slot];
+    int tile       = job_num % GEN16_TILES;
+    unsigned n_min = tile * (0x8000 / GEN16_TILES);
+    unsigned n_max = n_min + 0x8000 / GEN16_TILES - 1;
+    int tiles      = job_shard_range(slot * GEN16_TILES, GEN16_TILES);
+
+    kernel16_fn runner = runners16[variant][msg_len];
+    if (!runner)
+        runner = kernels16[variant].runner;
+    if (solve_linear)
+        MEASURE_TILES_AT(&variant16_timing[variant], tiles, variant16_names[variant],
+                kernels16[variant].solver(n_min, n_max); runner(n_min, n_max));
+    else if (gray_keys)
+        MEASURE_TILES_AT(&variant16_timing[variant], tiles, variant16_names[variant], kernels16[variant].gray(n_min, n_max));
+    else
+        MEASURE_TILES_AT(&variant16_timing[variant], tiles, variant16_names[variant], runner(n_min, n_max));
+
+    // a cancelled tile is not complete
+    if (!job_cancelled())
+        checkpoint_tile(job_num);
+    else
+        checkpoint_discard();
 }
 
 // e.g. Maverick-ET73x
@@ -145,7 +561,7 @@ __attribute__((noreturn))
 static void usage(int argc, char const *argv[])
 {
     (void)argc;
-    fprintf(stderr, "%s: codes.txt\n", argv[0]);
+    fprintf(stderr, "%s: [-v] [-p threads] [--pin] [--progress secs] [-a|--variant name...] [-l|-g] [--first] [--shard i/n] [-o results.txt] [-c checkpoint.txt [--resume]] codes.txt\n", argv[0]);
     exit(1);
 }
 
@@ -154,17 +570,82 @@ int main(int argc, char const *argv[])
     start_runtimes();
 
     int verbose = 0;
+    int resume  = 0;
+    int threads = 0;
+    int pin     = 0;
+    int all     = 0;
+
+    int i = 1;
+    for (; i < argc; ++i) {
+        if (*argv[i] != '-')
+            break;
+        if (!strcmp(argv[i], "--shard")) {
+            if (job_parse_shard(i + 1 < argc ? argv[++i] : NULL))
+                usage(argc, argv);
+        }
+        else if (!strcmp(argv[i], "--first"))
+            first_hit = 1;
+        else if (!strcmp(argv[i], "--pin"))
+            pin = 1;
+        else if (!strcmp(argv[i], "--progress") && i + 1 < argc)
+            job_progress(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--resume"))
+            resume = 1;
+        else if (!strcmp(argv[i], "--variant")) {
+            if (select_variant(i + 1 < argc ? argv[++i] : ""))
+                usage(argc, argv);
+        }
+        else if (argv[i][1] == 'h')
+            usage(argc, argv);
+        else if (argv[i][1] == 'v')
+            verbose++;
+        else if (argv[i][1] == 'o' && i + 1 < argc)
+            result_file = argv[++i];
+        else if (argv[i][1] == 'c' && i + 1 < argc)
+            checkpoint_file = argv[++i];
+        else if (argv[i][1] == 'p') {
+            if (argv[i][2])
+                threads = atoi(&argv[i][2]);
+            else if (i + 2 < argc && *argv[i + 1] >= '0' && *argv[i + 1] <= '9')
+                threads = atoi(argv[++i]);
+        }
+        else if (argv[i][1] == 'l')
+            solve_linear = 1;
+        else if (argv[i][1] == 'g')
+            gray_keys = 1;
+        else if (argv[i][1] == 'a')
+            all = 1;
+        else {
+            fprintf(stderr, "Wrong argument (%s).\n", argv[i]);
+            usage(argc, argv);
+        }
+    }
+
+    if (all) {
+        variant16_list_len = 0;
+        for (int v = 0; v < VARIANT16_COUNT; ++v)
+            select_variant(variant16_names[v]);
+    }
+    else if (!variant16_list_len) {
+        select_variant(variant16_names[0]);
+    }
+    int jobs = variant16_list_len * GEN16_TILES;
+
+    if (resume && !checkpoint_file) {
+        fprintf(stderr, "Use --resume with -c checkpoint.txt\n");
+        usage(argc, argv);
+    }
 
-    if (argc <= 1) {
+    if (argc <= i) {
         fprintf(stderr, "Reading STDIN...\n");
     }
-    int ret = read_codes(argv[1], data, &msg_len, MSG_MAX, LIST_MAX);
+    int ret = read_codes(argv[i], data, &msg_len, MSG_MAX, LIST_MAX);
     if (ret <= 0) {
         fprintf(stderr, "Missing data!\n");
         usage(argc, argv);
     }
     list_len = (unsigned)ret;
-    if (msg_len <= 1) {
+    if (msg_len <= 2) {
         fprintf(stderr, "Message length too short!\n");
         usage(argc, argv);
     }
@@ -172,18 +653,59 @@ int main(int argc, char const *argv[])
         print_codes(data, msg_len, list_len);
 
     fprintf(stderr, "Processing...\n");
+    if (msg_matrix_init(&msgs, data, msg_len, list_len) < 0)
+        exit(1);
     msg_len -= 2; // use 16-bit chk
 
-    numofthreads = job_default_thread_count();
-    job_exec_parallel(runner, numofthreads);
+    chk16_enc[0] = msgs.chk16;
+    for (unsigned j = 0; j < list_len; ++j) {
+        chk16_swapped[j] = (msgs.chk16[j] << 8) | (msgs.chk16[j] >> 8);
+    }
 
-    // byte swap and run again
-    fprintf(stderr, "Swapping byte order\n");
-    for (unsigned i = 0; i < list_len; ++i) {
-        data[i].chk16 = (data[i].chk16 << 8) | (data[i].chk16 >> 8);
+    for (int v = 0; v < VARIANT16_COUNT; ++v) {
+        for (int e = 0; e < CHK_ENCODINGS; ++e) {
+            snprintf(variant16_labels[v * CHK_ENCODINGS + e], sizeof(variant16_labels[0]), "%s%s", variant16_names[v], chk16_enc_names[e]);
+        }
     }
-    found = 0;
-    job_exec_parallel(runner, numofthreads);
+
+    // identify the search by the codes and the selected variants, a hex digit for each in job order
+    uint32_t hash = msg_matrix_hash(&msgs);
+    char variants[VARIANT16_COUNT + 1] = {0};
+    for (int j = 0; j < variant16_list_len; ++j)
+        variants[j] = "0123456789abcdef"[variant16_list[j]];
+
+    if (checkpoint_file) {
+        char header[160];
+        snprintf(header, sizeof(header), "revdgst16 checkpoint %s shard %d/%d of %u codes %08x variants %s",
+                solve_linear ? "-l" : gray_keys ? "-g" : "-", job_shard_index + 1, job_shard_count, list_len, hash, variants);
+        if (checkpoint_open(checkpoint_file, header, jobs, resume, restore))
+            exit(1);
+    }
+
+    for (int j = 0; j < variant16_list_len; ++j) {
+        int v     = variant16_list[j];
+        int tiles = job_shard_range(j * GEN16_TILES, GEN16_TILES);
+        if (tiles)
+            measure_tiles_init(&variant16_timing[v], tiles, variant16_names[v]);
+    }
+
+    job_exec_parallel(job_run, NULL, jobs, threads, pin);
+    measure_tiles_flush(); // variants cut short by --first or resumed from a checkpoint
+
+    checkpoint_close();
+
+    result_collect();
+    print_results();
+    if (result_file) {
+        char header[128];
+        snprintf(header, sizeof(header), "revdgst16 shard %d/%d of %u codes %08x variants %s",
+                job_shard_index + 1, job_shard_count, list_len, hash, variants);
+        if (result_write(result_file, header))
+            exit(1);
+    }
+    result_free();
+
+    msg_matrix_free(&msgs);
 
     print_runtimes();
 }
@@ -0,0 +1,214 @@
+/** @file
+    revmerge: merge the result files of sharded revdgst and revdgst16 runs.
+
+    Copyright (C) 2019 Christian W. Zuckschwerdt <zany@triq.net>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "result.h"
+
+/*
+Reads any number of result files (see result.h) and prints one ranked report.
+Results are ranked by the fraction of matched codes, best first, ties are ordered
+by variant, gen, key, and combiner. Results present in several files are listed once.
+
+Each file starts with the header of its search, "# TOOL shard I/N of COUNT codes HASH",
+revdgst16 adds the selected variants. Only the shard index may differ between the files,
+results of another tool, other codes, another shard count or other variants are rejected.
+*/
+
+struct search {
+    char tool[32];
+    int shard_count;
+    unsigned codes;
+    unsigned hash;
+    char variants[32];
+};
+
+static struct search merge_search; // of the first file
+static char merge_header[256];
+static int merge_search_set;
+static int merge_digits = 4; // hex digits of gen, key, and final, by tool
+
+/// Parse a result file header line. Returns 0 on success.
+static int search_parse(char const *line, struct search *s)
+{
+    int shard_index = 0;
+    int pos         = 0;
+    memset(s, 0, sizeof(*s));
+    if (sscanf(line, "# %31s shard %d/%d of %u codes %x%n", s->tool, &shard_index, &s->shard_count, &s->codes, &s->hash, &pos) != 5 || !pos)
+        return -1;
+    if (shard_index < 1 || shard_index > s->shard_count)
+        return -1;
+    if (sscanf(line + pos, " variants %31s", s->variants) != 1)
+        s->variants[0] = '\0';
+    return 0;
+}
+
+static int search_cmp(struct search const *a, struct search const *b)
+{
+    return strcmp(a->tool, b->tool) || a->shard_count != b->shard_count || a->codes != b->codes
+            || a->hash != b->hash || strcmp(a->variants, b->variants);
+}
+
+struct merged {
+    unsigned matches;
+    unsigned total;
+    unsigned gen;
+    unsigned key;
+    unsigned final;
+    char combiner[32];
+    char variant[64];
+};
+
+static struct merged *merged_list;
+static unsigned merged_len;
+static unsigned merged_cap;
+
+static void merged_add(struct merged const *m)
+{
+    if (merged_len >= merged_cap) {
+        merged_cap  = merged_cap ? merged_cap * 2 : 64;
+        merged_list = realloc(merged_list, merged_cap * sizeof(*merged_list));
+        if (!merged_list) {
+            perror("merged_add realloc");
+            exit(1);
+        }
+    }
+    merged_list[merged_len++] = *m;
+}
+
+static int merged_cmp(void const *a, void const *b)
+{
+    struct merged const *ma = a;
+    struct merged const *mb = b;
+    // compare matches/total without division
+    unsigned long long ra = (unsigned long long)ma->matches * mb->total;
+    unsigned long long rb = (unsigned long long)mb->matches * ma->total;
+    if (ra != rb)
+        return ra > rb ? -1 : 1;
+    int c = strcmp(ma->variant, mb->variant);
+    if (c)
+        return c;
+    if (ma->gen != mb->gen)
+        return ma->gen < mb->gen ? -1 : 1;
+    if (ma->key != mb->key)
+        return ma->key < mb->key ? -1 : 1;
+    c = strcmp(ma->combiner, mb->combiner);
+    if (c)
+        return c;
+    if (ma->final != mb->final)
+        return ma->final < mb->final ? -1 : 1;
+    if (ma->total != mb->total)
+        return ma->total < mb->total ? -1 : 1;
+    return 0;
+}
+
+/// Read one result file. Returns the number of results read or -1 on error.
+static int read_results(char const *filename)
+{
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return -1;
+    }
+
+    int count = 0;
+    unsigned line_num = 0;
+    int header = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        line_num++;
+        if (!header && line[0] == '#') {
+            struct search search;
+            if (search_parse(line, &search)) {
+                fprintf(stderr, "%s:%u: bad header, not a revdgst or revdgst16 result file.\n", filename, line_num);
+                fclose(fp);
+                return -1;
+            }
+            line[strcspn(line, "\r\n")] = '\0';
+            if (!merge_search_set) {
+                snprintf(merge_header, sizeof(merge_header), "%s", line);
+                merge_search     = search;
+                merge_search_set = 1;
+                merge_digits     = strcmp(search.tool, "revdgst") ? 4 : 2;
+            }
+            else if (search_cmp(&search, &merge_search)) {
+                fprintf(stderr, "%s:%u: results of another search, \"%s\" but expected \"%s\".\n",
+                        filename, line_num, line, merge_header);
+                fclose(fp);
+                return -1;
+            }
+            header = 1;
+            continue;
+        }
+        if (line[0] == '#' || line[0] == '\r' || line[0] == '\n')
+            continue;
+        if (!header) {
+            fprintf(stderr, "%s:%u: missing header, not a revdgst or revdgst16 result file.\n", filename, line_num);
+            fclose(fp);
+            return -1;
+        }
+
+        struct result r;
+        if (result_parse(line, &r)) {
+            fprintf(stderr, "%s:%u: bad result line, skipping.\n", filename, line_num);
+            continue;
+        }
+        struct merged m = {r.matches, r.total, r.gen, r.key, r.final, {0}, {0}};
+        snprintf(m.combiner, sizeof(m.combiner), "%s", r.combiner);
+        snprintf(m.variant, sizeof(m.variant), "%s", r.variant_name);
+
+        merged_add(&m);
+        count++;
+    }
+
+    fclose(fp);
+    return count;
+}
+
+__attribute__((noreturn))
+static void usage(int argc, char const *argv[])
+{
+    (void)argc;
+    fprintf(stderr, "%s: results.txt...\n", argv[0]);
+    exit(1);
+}
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2 || (argv[1][0] == '-' && argv[1][1] == 'h'))
+        usage(argc, argv);
+
+    for (int i = 1; i < argc; ++i) {
+        int ret = read_results(argv[i]);
+        if (ret < 0)
+            exit(1);
+        fprintf(stderr, "Read %d results from %s\n", ret, argv[i]);
+    }
+
+    if (merged_len)
+        qsort(merged_list, merged_len, sizeof(*merged_list), merged_cmp);
+
+    unsigned rank = 0;
+    for (unsigned i = 0; i < merged_len; ++i) {
+        struct merged const *m = &merged_list[i];
+        if (i > 0 && !merged_cmp(m, &merged_list[i - 1]))
+            continue; // duplicate, e.g. from overlapping shards
+        printf("%4u. g %0*x k %0*x final %0*x using %s (%s) matches %u/%u (%.0f %%)\n",
+                ++rank, merge_digits, m->gen, merge_digits, m->key, merge_digits, m->final, m->combiner, m->variant,
+                m->matches, m->total, 100.0 * m->matches / m->total);
+    }
+    if (!rank)
+        printf("No results.\n");
+
+    free(merged_list);
+}
@@ -12,10 +12,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "intrinsic.h"
 #include "util.h"
 #include "measure.h"
+#include "job.h"
 #include "codes.h"
 
 static struct data data[LIST_MAX];
@@ -27,11 +29,38 @@ static unsigned min_matches = 0;
 Modify these algorithms to test other possible checksum methods.
 
 You can also add more algorithms (PR if you have a nice one!).
-Remember to add any new algorithm to run_algos().
+Remember to add any new algorithm to algos[].
 
-If you want to scan different parts of the messages change scan_algos().
+If you want to scan different parts of the messages change scan_window().
 */
 
+/// The messages transformed by INVERT and BYTE_REFLECT, one matrix per transform.
+enum transform {
+    TRANSFORM_PLAIN,
+    TRANSFORM_INVERT,
+    TRANSFORM_REFLECT,
+    TRANSFORM_INVERT_REFLECT,
+    TRANSFORM_COUNT,
+};
+
+static char const *transform_labels[TRANSFORM_COUNT] = {
+        "Processing...",
+        "INVERT Inverting...",
+        "BYTE_REFLECT Reflecting...",
+        "INVERT BYTE_REFLECT Inverting...",
+};
+
+static struct msg_matrix msgs[TRANSFORM_COUNT];
+
+/// A scan of one window of the messages, the findings are printed to out.
+struct scan {
+    FILE *out;
+    uint8_t (*d)[MSG_STRIDE];
+    unsigned off;
+    unsigned len;
+    unsigned chk;
+};
+
 static void row_weight(void)
 {
     unsigned max_weight = 0;
@@ -41,7 +70,7 @@ static void row_weight(void)
     for (unsigned i = 0; i < list_len; ++i) {
         unsigned weight = 0;
         for (unsigned j = 0; j < msg_len; ++j) {
-            weight += popcount(data[i].d[j]);
+            weight += popcount(msgs[TRANSFORM_PLAIN].d[i][j]);
         }
         if (weight > max_weight) max_weight = weight;
         if (weight < min_weight) min_weight = weight;
@@ -55,144 +84,135 @@ static void row_weight(void)
     printf("Avg %.1f /%u bit (%.1f%%)\n", avg_weight, msg_len * 8, avg_weight * 100.0 / msg_len / 8);
 }
 
-static void byte_sums(unsigned off, unsigned len, unsigned chk)
-{
-    unsigned max_add = 0;
-    unsigned max_sub = 0;
-    unsigned max_xor = 0;
-    uint8_t rem_add = 0;
-    uint8_t rem_sub = 0;
-    uint8_t rem_xor = 0;
+/*
+Each scan computes the residual of every message once and counts them in a histogram.
+The most common residual is the same as found by comparing every pair of messages,
+on ties the residual of the earliest message wins.
+With instrumentation every residual histogram is a candidate, and every finding is counted
+as a survivor by how the residual is formed: the sums as "sum add", "sum sub", "sum xor",
+the CRC and XOR digests as "xor xor".
+*/
 
-    for (unsigned i = 0; i < list_len; ++i) {
-        unsigned found_add = 0;
-        unsigned found_sub = 0;
-        unsigned found_xor = 0;
-        uint8_t sumi = add_bytes(&data[i].d[off], len);
-        uint8_t addi = sumi + data[i].d[chk];
-        uint8_t subi = sumi - data[i].d[chk];
-        uint8_t xori = sumi ^ data[i].d[chk];
+#define SURVIVOR_SUM_XOR (INSTR_SURVIVORS + 0)
+#define SURVIVOR_XOR_XOR (INSTR_SURVIVORS + 1)
+#define SURVIVOR_SUM_ADD (INSTR_SURVIVORS + 2)
+#define SURVIVOR_SUM_SUB (INSTR_SURVIVORS + 4)
 
-        for (unsigned j = 0; j < list_len; ++j) {
-            uint8_t sumj = add_bytes(&data[j].d[off], len);
-            uint8_t addj = sumj + data[j].d[chk];
-            uint8_t subj = sumj - data[j].d[chk];
-            uint8_t xorj = sumj ^ data[j].d[chk];
-
-            if (addi == addj) found_add++;
-            if (subi == subj) found_sub++;
-            if (xori == xorj) found_xor++;
-        }
-        if (found_add > max_add) {
-            max_add = found_add;
-            rem_add = addi;
-        }
-        if (found_sub > max_sub) {
-            max_sub = found_sub;
-            rem_sub = subi;
-        }
-        if (found_xor > max_xor) {
-            max_xor = found_xor;
-            rem_xor = xori;
+static _Thread_local uint8_t res_add[LIST_MAX];
+static _Thread_local uint8_t res_sub[LIST_MAX];
+static _Thread_local uint8_t res_xor[LIST_MAX];
+
+/// Count of the most common residual, which is stored to @p value.
+static unsigned consensus(uint8_t const *res, unsigned n, uint8_t *value)
+{
+    INSTR_ADD(INSTR_CANDIDATES, 1);
+    INSTR_ADD(INSTR_SCORED, n);
+    unsigned hist[256] = {0};
+    for (unsigned i = 0; i < n; ++i)
+        hist[res[i]]++;
+
+    unsigned max = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        if (hist[res[i]] > max) {
+            max    = hist[res[i]];
+            *value = res[i];
         }
     }
+    return max;
+}
+
+static void byte_sums(struct scan const *s, unsigned lo, unsigned hi)
+{
+    (void)lo;
+    (void)hi;
+    unsigned off = s->off;
+    unsigned len = s->len;
+    unsigned chk = s->chk;
+    for (unsigned i = 0; i < list_len; ++i) {
+        uint8_t sum = add_bytes(&s->d[i][off], len);
+        res_add[i]  = sum + s->d[i][chk];
+        res_sub[i]  = sum - s->d[i][chk];
+        res_xor[i]  = sum ^ s->d[i][chk];
+    }
+    uint8_t rem_add = 0;
+    uint8_t rem_sub = 0;
+    uint8_t rem_xor = 0;
+    unsigned max_add = consensus(res_add, list_len, &rem_add);
+    unsigned max_sub = consensus(res_sub, list_len, &rem_sub);
+    unsigned max_xor = consensus(res_xor, list_len, &rem_xor);
 
     if (max_add > min_matches) {
-        printf("Found: add_bytes(&b[%u], %u) + b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_add, max_add * 100.0 / list_len);
+        INSTR_ADD(SURVIVOR_SUM_ADD, 1);
+        fprintf(s->out, "Found: add_bytes(&b[%u], %u) + b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_add, max_add * 100.0 / list_len);
     }
     if (max_sub > min_matches) {
-        printf("Found: add_bytes(&b[%u], %u) - b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_sub, max_sub * 100.0 / list_len);
+        INSTR_ADD(SURVIVOR_SUM_SUB, 1);
+        fprintf(s->out, "Found: add_bytes(&b[%u], %u) - b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_sub, max_sub * 100.0 / list_len);
     }
     if (max_xor > min_matches) {
-        printf("Found: add_bytes(&b[%u], %u) ^ b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_xor, max_xor * 100.0 / list_len);
+        INSTR_ADD(SURVIVOR_SUM_XOR, 1);
+        fprintf(s->out, "Found: add_bytes(&b[%u], %u) ^ b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_xor, max_xor * 100.0 / list_len);
     }
 }
 
-static void nibble_sums(unsigned off, unsigned len, unsigned chk)
+static void nibble_sums(struct scan const *s, unsigned lo, unsigned hi)
 {
-    unsigned max_add = 0;
-    unsigned max_sub = 0;
-    unsigned max_xor = 0;
+    (void)lo;
+    (void)hi;
+    unsigned off = s->off;
+    unsigned len = s->len;
+    unsigned chk = s->chk;
+    for (unsigned i = 0; i < list_len; ++i) {
+        uint8_t sum = add_nibbles(&s->d[i][off], len);
+        res_add[i]  = sum + s->d[i][chk];
+        res_sub[i]  = sum - s->d[i][chk];
+        res_xor[i]  = sum ^ s->d[i][chk];
+    }
     uint8_t rem_add = 0;
     uint8_t rem_sub = 0;
     uint8_t rem_xor = 0;
-
-    for (unsigned i = 0; i < list_len; ++i) {
-        unsigned found_add = 0;
-        unsigned found_sub = 0;
-        unsigned found_xor = 0;
-        uint8_t sumi = add_nibbles(&data[i].d[off], len);
-        uint8_t addi = sumi + data[i].d[chk];
-        uint8_t subi = sumi - data[i].d[chk];
-        uint8_t xori = sumi ^ data[i].d[chk];
-
-        for (unsigned j = 0; j < list_len; ++j) {
-            uint8_t sumj = add_nibbles(&data[j].d[off], len);
-            uint8_t addj = sumj + data[j].d[chk];
-            uint8_t subj = sumj - data[j].d[chk];
-            uint8_t xorj = sumj ^ data[j].d[chk];
-
-            if (addi == addj) found_add++;
-            if (subi == subj) found_sub++;
-            if (xori == xorj) found_xor++;
-        }
-        if (found_add > max_add) {
-            max_add = found_add;
-            rem_add = addi;
-        }
-        if (found_sub > max_sub) {
-            max_sub = found_sub;
-            rem_sub = subi;
-        }
-        if (found_xor > max_xor) {
-            max_xor = found_xor;
-            rem_xor = xori;
-        }
-    }
+    unsigned max_add = consensus(res_add, list_len, &rem_add);
+    unsigned max_sub = consensus(res_sub, list_len, &rem_sub);
+    unsigned max_xor = consensus(res_xor, list_len, &rem_xor);
 
     if (max_add > min_matches) {
-        printf("Found: add_nibbles(&b[%u], %u) + b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_add, max_add * 100.0 / list_len);
+        INSTR_ADD(SURVIVOR_SUM_ADD, 1);
+        fprintf(s->out, "Found: add_nibbles(&b[%u], %u) + b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_add, max_add * 100.0 / list_len);
     }
     if (max_sub > min_matches) {
-        printf("Found: add_nibbles(&b[%u], %u) - b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_sub, max_sub * 100.0 / list_len);
+        INSTR_ADD(SURVIVOR_SUM_SUB, 1);
+        fprintf(s->out, "Found: add_nibbles(&b[%u], %u) - b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_sub, max_sub * 100.0 / list_len);
     }
     if (max_xor > min_matches) {
-        printf("Found: add_nibbles(&b[%u], %u) ^ b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_xor, max_xor * 100.0 / list_len);
+        INSTR_ADD(SURVIVOR_SUM_XOR, 1);
+        fprintf(s->out, "Found: add_nibbles(&b[%u], %u) ^ b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_xor, max_xor * 100.0 / list_len);
     }
 }
 
-static void crc8_scan(unsigned off, unsigned len, unsigned chk)
+static void crc8_scan(struct scan const *s, unsigned lo, unsigned hi)
 {
-    for (unsigned p = 1; p <= 255; ++p) {
-        unsigned found_max = 0;
-        uint8_t found_poly = 0;
-        uint8_t found_fin = 0;
-
+    unsigned off = s->off;
+    unsigned len = s->len;
+    unsigned chk = s->chk;
+    uint8_t table[8][256];
+    for (unsigned p = lo ? lo : 1; p < hi; ++p) {
+        crc8_slice_init(table, p);
         for (unsigned i = 0; i < list_len; ++i) {
-            unsigned found = 0;
-            uint8_t chki = crc8(&data[i].d[off], len, p, 0x00) ^ data[i].d[chk];
-
-            for (unsigned j = 0; j < list_len; ++j) {
-                uint8_t chkj = crc8(&data[j].d[off], len, p, 0x00) ^ data[j].d[chk];
-                if (chki == chkj) {
-                    found++;
-                }
-            }
-
-            if (found > found_max) {
-                found_max = found;
-                found_poly = p;
-                found_fin = chki; // final xor for random init of 0x00
-            }
+            res_xor[i] = crc8_slice8(&s->d[i][off], len, table, 0x00) ^ s->d[i][chk];
         }
+        uint8_t found_fin  = 0; // final xor for random init of 0x00
+        unsigned found_max = consensus(res_xor, list_len, &found_fin);
+        uint8_t found_poly = p;
 
         if (found_max > min_matches) {
+            INSTR_ADD(SURVIVOR_XOR_XOR, 1);
             int found_init = -1;
             // recover the init
             for (int q = 0; q <= 255; ++q) {
                 unsigned init_match = 0;
+                INSTR_ADD(INSTR_SCORED, list_len);
                 for (unsigned j = 0; j < list_len; ++j) {
-                    uint8_t chkj = crc8(&data[j].d[off], len, p, q) ^ data[j].d[chk];
+                    uint8_t chkj = crc8_slice8(&s->d[j][off], len, table, q) ^ s->d[j][chk];
                     if (chkj == 0) {
                         init_match++;
                     }
@@ -204,49 +224,41 @@ static void crc8_scan(unsigned off, unsigned len, unsigned chk)
             }
 
             if (found_init >= 0) {
-                printf("Found: crc8(&b[%u], %u, 0x%02x, 0x%02x) == b[%u]; // (%.1f%%)\n",
+                fprintf(s->out, "Found: crc8(&b[%u], %u, 0x%02x, 0x%02x) == b[%u]; // (%.1f%%)\n",
                         off, len, found_poly, (uint8_t)found_init, chk, found_max * 100.0 / list_len);
             }
             else {
-                printf("Found: crc8(&b[%u], %u, 0x%02x, 0x%02x) ^ b[%u] == 0x%02x; // (%.1f%%)\n",
+                fprintf(s->out, "Found: crc8(&b[%u], %u, 0x%02x, 0x%02x) ^ b[%u] == 0x%02x; // (%.1f%%)\n",
                         off, len, found_poly, (uint8_t)0, chk, found_fin, found_max * 100.0 / list_len);
             }
         }
     }
 }
 
-static void crc4_scan(unsigned off, unsigned len, unsigned chk)
+static void crc4_scan(struct scan const *s, unsigned lo, unsigned hi)
 {
-    for (int p = 1; p <= 15; ++p) {
-        unsigned found_max = 0;
-        uint8_t found_poly = 0;
-        uint8_t found_fin = 0;
-
+    unsigned off = s->off;
+    unsigned len = s->len;
+    unsigned chk = s->chk;
+    uint8_t table[256];
+    for (unsigned p = lo ? lo : 1; p < hi; ++p) {
+        crc8_table_init(table, p << 4);
         for (unsigned i = 0; i < list_len; ++i) {
-            unsigned found = 0;
-            uint8_t chki = crc4(&data[i].d[off], len, p, 0x00) ^ data[i].d[chk];
-
-            for (unsigned j = 0; j < list_len; ++j) {
-                uint8_t chkj = crc4(&data[j].d[off], len, p, 0x00) ^ data[j].d[chk];
-                if (chki == chkj) {
-                    found++;
-                }
-            }
-
-            if (found > found_max) {
-                found_max = found;
-                found_poly = p;
-                found_fin  = chki; // final xor for random init of 0x00
-            }
+            res_xor[i] = crc4_table(&s->d[i][off], len, table, 0x00) ^ s->d[i][chk];
         }
+        uint8_t found_fin  = 0; // final xor for random init of 0x00
+        unsigned found_max = consensus(res_xor, list_len, &found_fin);
+        uint8_t found_poly = p;
 
         if (found_max > min_matches) {
+            INSTR_ADD(SURVIVOR_XOR_XOR, 1);
             int found_init = -1;
             // recover the init
             for (int q = 0; q <= 15; ++q) {
                 unsigned init_match = 0;
+                INSTR_ADD(INSTR_SCORED, list_len);
                 for (unsigned j = 0; j < list_len; ++j) {
-                    uint8_t chkj = crc4(&data[j].d[off], len, p, q) ^ data[j].d[chk];
+                    uint8_t chkj = crc4_table(&s->d[j][off], len, table, q) ^ s->d[j][chk];
                     if (chkj == 0) {
                         init_match++;
                     }
@@ -258,11 +270,11 @@ static void crc4_scan(unsigned off, unsigned len, unsigned chk)
             }
 
             if (found_init >= 0) {
-                printf("Found: crc4(&b[%u], %u, 0x%02x, 0x%02x) == b[%u]; // (%.1f%%)\n",
+                fprintf(s->out, "Found: crc4(&b[%u], %u, 0x%02x, 0x%02x) == b[%u]; // (%.1f%%)\n",
                         off, len, found_poly, (uint8_t)found_init, chk, found_max * 100.0 / list_len);
             }
             else {
-                printf("Found: crc4(&b[%u], %u, 0x%02x, 0x%02x) ^ b[%u] == 0x%02x; // (%.1f%%)\n",
+                fprintf(s->out, "Found: crc4(&b[%u], %u, 0x%02x, 0x%02x) ^ b[%u] == 0x%02x; // (%.1f%%)\n",
                         off, len, found_poly, (uint8_t)0, chk, found_fin, found_max * 100.0 / list_len);
             }
         }
@@ -286,66 +298,387 @@ static inline uint8_t xor_shift_bytes(uint8_t const message[], unsigned num_byte
     return result;
 }
 
-static void xor_shift(unsigned off, unsigned len, unsigned chk)
+static void xor_shift(struct scan const *s, unsigned lo, unsigned hi)
 {
-    for (int shift_up = 0; shift_up <= 127; ++shift_up) {
+    unsigned off = s->off;
+    unsigned len = s->len;
+    unsigned chk = s->chk;
+    for (unsigned shift_up = lo; shift_up < hi; ++shift_up) {
         for (int shift_dn = 0; shift_dn <= 127; ++shift_dn) {
-            unsigned found_max = 0;
-            uint8_t found_shift_up = 0;
-            uint8_t found_shift_dn = 0;
+            for (unsigned i = 0; i < list_len; ++i) {
+                res_xor[i] = xor_shift_bytes(&s->d[i][off], len, shift_up, shift_dn) ^ s->d[i][chk];
+            }
+            uint8_t found_fin;
+            unsigned found_max     = consensus(res_xor, list_len, &found_fin);
+            uint8_t found_shift_up = shift_up;
+            uint8_t found_shift_dn = shift_dn;
+
+            if (found_max > min_matches) {
+                INSTR_ADD(SURVIVOR_XOR_XOR, 1);
+                fprintf(s->out, "Found: xor_shift_bytes(&b[%u], %u, 0x%02x, 0x%02x) ^ b[%u] == 0; // (%.1f%%)\n",
+                        off, len, found_shift_up, found_shift_dn, chk, found_max * 100.0 / list_len);
+            }
+        }
+    }
+}
+
+/*
+The sweep (-a) tries every data window and every checksum position outside of it.
+Each task takes one start offset and extends the window a byte at a time,
+the running sums and CRC states of every message are updated with just the new byte,
+so each window costs about one byte per message instead of its length.
+
+If more than min_matches codes have the same bytes in the window and at the checksum,
+every algorithm matches, these layouts are skipped. A majority is found with a Boyer-Moore vote
+over running hashes of the window bytes. INVERT and BYTE_REFLECT map equal bytes to equal bytes,
+so this is the same for all transforms and found once.
+*/
+
+static uint8_t sweep_trivial[MSG_MAX][MSG_MAX + 1][MSG_MAX]; // by off, len, chk
+
+#define SWEEP_HASH_PRIME 0x100000001b3ULL
+
+__attribute__((always_inline))
+static inline uint64_t sweep_key(uint64_t const *hash, unsigned i, unsigned chk)
+{
+    return (hash[i] ^ msgs[TRANSFORM_PLAIN].d[i][chk]) * SWEEP_HASH_PRIME;
+}
+
+/// Check if more than min_matches codes have the same window and checksum bytes.
+static int sweep_majority(uint64_t const *hash, unsigned chk)
+{
+    uint64_t candidate = 0;
+    unsigned votes     = 0;
+    for (unsigned i = 0; i < list_len; ++i) {
+        uint64_t key = sweep_key(hash, i, chk);
+        if (!votes)
+            candidate = key;
+        votes += key == candidate ? 1 : -1;
+    }
+    unsigned count = 0;
+    for (unsigned i = 0; i < list_len; ++i) {
+        count += sweep_key(hash, i, chk) == candidate;
+    }
+    return count > min_matches;
+}
+
+/// Find the trivial layouts of the windows starting at @p off, a job for each offset.
+static void sweep_init(void *ctx, int off)
+{
+    (void)ctx;
+    uint64_t *hash = malloc(list_len * sizeof(*hash));
+    if (!hash) {
+        perror("sweep_init malloc");
+        exit(1);
+    }
+    for (unsigned i = 0; i < list_len; ++i) {
+        hash[i] = 0xcbf29ce484222325ULL;
+    }
+    for (unsigned len = 1; off + len <= msg_len; ++len) {
+        for (unsigned i = 0; i < list_len; ++i) {
+            hash[i] = (hash[i] ^ msgs[TRANSFORM_PLAIN].d[i][off + len - 1]) * SWEEP_HASH_PRIME;
+        }
+        for (unsigned chk = 0; chk < msg_len; ++chk) {
+            if (chk < (unsigned)off || chk >= off + len)
+                sweep_trivial[off][len][chk] = sweep_majority(hash, chk);
+        }
+    }
+    free(hash);
+}
+
+/// Check if a checksum at @p chk can be tested against the window @p off, @p len.
+static int sweep_usable(unsigned off, unsigned len, unsigned chk)
+{
+    return (chk < off || chk >= off + len) && !sweep_trivial[off][len][chk];
+}
+
+static _Thread_local uint8_t run_add[LIST_MAX];
+static _Thread_local uint8_t run_nib[LIST_MAX];
+static _Thread_local uint8_t run_xor[LIST_MAX];
+
+static void report_sums(struct scan const *s, char const *name, uint8_t const *run, unsigned off, unsigned len, unsigned chk)
+{
+    for (unsigned i = 0; i < list_len; ++i) {
+        res_add[i] = run[i] + s->d[i][chk];
+        res_sub[i] = run[i] - s->d[i][chk];
+        res_xor[i] = run[i] ^ s->d[i][chk];
+    }
+    uint8_t rem_add = 0;
+    uint8_t rem_sub = 0;
+    uint8_t rem_xor = 0;
+    unsigned max_add = consensus(res_add, list_len, &rem_add);
+    unsigned max_sub = consensus(res_sub, list_len, &rem_sub);
+    unsigned max_xor = consensus(res_xor, list_len, &rem_xor);
+
+    if (max_add > min_matches) {
+        INSTR_ADD(SURVIVOR_SUM_ADD, 1);
+        fprintf(s->out, "Found: %s(&b[%u], %u) + b[%u] == 0x%02x; // (%.1f%%)\n", name, off, len, chk, rem_add, max_add * 100.0 / list_len);
+    }
+    if (max_sub > min_matches) {
+        INSTR_ADD(SURVIVOR_SUM_SUB, 1);
+        fprintf(s->out, "Found: %s(&b[%u], %u) - b[%u] == 0x%02x; // (%.1f%%)\n", name, off, len, chk, rem_sub, max_sub * 100.0 / list_len);
+    }
+    if (max_xor > min_matches) {
+        INSTR_ADD(SURVIVOR_SUM_XOR, 1);
+        fprintf(s->out, "Found: %s(&b[%u], %u) ^ b[%u] == 0x%02x; // (%.1f%%)\n", name, off, len, chk, rem_xor, max_xor * 100.0 / list_len);
+    }
+}
+
+static void sums_sweep(struct scan const *s, unsigned lo, unsigned hi)
+{
+    (void)lo;
+    (void)hi;
+    unsigned off = s->off;
+    for (unsigned i = 0; i < list_len; ++i) {
+        run_add[i] = run_nib[i] = run_xor[i] = 0;
+    }
+    for (unsigned len = 1; off + len <= msg_len; ++len) {
+        for (unsigned i = 0; i < list_len; ++i) {
+            uint8_t b = s->d[i][off + len - 1];
+            run_add[i] += b;
+            run_nib[i] += (b >> 4) + (b & 0x0f);
+            run_xor[i] ^= b;
+        }
+        for (unsigned chk = 0; chk < msg_len; ++chk) {
+            if (!sweep_usable(off, len, chk))
+                continue;
+            report_sums(s, "add_bytes", run_add, off, len, chk);
+            report_sums(s, "add_nibbles", run_nib, off, len, chk);
 
             for (unsigned i = 0; i < list_len; ++i) {
-                unsigned found = 0;
-                uint8_t chki = xor_shift_bytes(&data[i].d[off], len, shift_up, shift_dn) ^ data[i].d[chk];
+                res_xor[i] = run_xor[i] ^ s->d[i][chk];
+            }
+            uint8_t rem_xor  = 0;
+            unsigned max_xor = consensus(res_xor, list_len, &rem_xor);
+            if (max_xor > min_matches) {
+                INSTR_ADD(SURVIVOR_XOR_XOR, 1);
+                fprintf(s->out, "Found: xor_bytes(&b[%u], %u) ^ b[%u] == 0x%02x; // (%.1f%%)\n", off, len, chk, rem_xor, max_xor * 100.0 / list_len);
+            }
+        }
+    }
+}
 
-                for (unsigned j = 0; j < list_len; ++j) {
-                    uint8_t chkj = xor_shift_bytes(&data[j].d[off], len, shift_up, shift_dn) ^ data[j].d[chk];
-                    if (chki == chkj) {
-                        found++;
-                    }
-                }
+/*
+A CRC is linear in the init and the message, the CRC with init q is the CRC with init 0
+XOR the CRC of q followed by len zero bytes. The init is recovered from the residuals
+of the sweep without running the CRC over the messages again.
+*/
 
-                if (found > found_max) {
-                    found_max = found;
-                    found_shift_up = shift_up;
-                    found_shift_dn = shift_dn;
-                }
+/// Find the first init that matches @p found_max codes, or -1. The table state is shifted by @p shift.
+static int sweep_init_recover(uint8_t const table[256], unsigned len, unsigned shift, unsigned q_max, unsigned found_max)
+{
+    for (unsigned q = 0; q <= q_max; ++q) {
+        uint8_t zeros = q << shift;
+        for (unsigned k = 0; k < len; ++k) {
+            zeros = table[zeros];
+        }
+        zeros >>= shift;
+        unsigned init_match = 0;
+        INSTR_ADD(INSTR_SCORED, list_len);
+        for (unsigned j = 0; j < list_len; ++j) {
+            init_match += res_xor[j] == zeros;
+        }
+        if (init_match == found_max)
+            return q;
+    }
+    return -1;
+}
+
+static void crc_sweep(struct scan const *s, char const *name, uint8_t const table[256], unsigned shift, unsigned p)
+{
+    unsigned off = s->off;
+    for (unsigned i = 0; i < list_len; ++i) {
+        run_xor[i] = 0;
+    }
+    for (unsigned len = 1; off + len <= msg_len; ++len) {
+        for (unsigned i = 0; i < list_len; ++i) {
+            run_xor[i] = table[run_xor[i] ^ s->d[i][off + len - 1]];
+        }
+        for (unsigned chk = 0; chk < msg_len; ++chk) {
+            if (!sweep_usable(off, len, chk))
+                continue;
+            for (unsigned i = 0; i < list_len; ++i) {
+                res_xor[i] = (run_xor[i] >> shift) ^ s->d[i][chk];
             }
+            uint8_t found_fin  = 0; // final xor for random init of 0x00
+            unsigned found_max = consensus(res_xor, list_len, &found_fin);
+            if (found_max <= min_matches)
+                continue;
+            INSTR_ADD(SURVIVOR_XOR_XOR, 1);
 
-            if (found_max > min_matches) {
-                printf("Found: xor_shift_bytes(&b[%u], %u, 0x%02x, 0x%02x) ^ b[%u] == 0; // (%.1f%%)\n",
-                        off, len, found_shift_up, found_shift_dn, chk, found_max * 100.0 / list_len);
+            int found_init = sweep_init_recover(table, len, shift, 0xff >> shift, found_max);
+            if (found_init >= 0) {
+                fprintf(s->out, "Found: %s(&b[%u], %u, 0x%02x, 0x%02x) == b[%u]; // (%.1f%%)\n",
+                        name, off, len, p, (uint8_t)found_init, chk, found_max * 100.0 / list_len);
+            }
+            else {
+                fprintf(s->out, "Found: %s(&b[%u], %u, 0x%02x, 0x%02x) ^ b[%u] == 0x%02x; // (%.1f%%)\n",
+                        name, off, len, p, (uint8_t)0, chk, found_fin, found_max * 100.0 / list_len);
             }
         }
     }
 }
 
-static void run_algos(unsigned off, unsigned len, unsigned chk)
+static void crc8_sweep(struct scan const *s, unsigned lo, unsigned hi)
 {
-    byte_sums(off, len, chk);
-    nibble_sums(off, len, chk);
-    crc8_scan(off, len, chk);
-    crc4_scan(off, len, chk);
-    xor_shift(off, len, chk);
+    uint8_t table[256];
+    for (unsigned p = lo ? lo : 1; p < hi; ++p) {
+        crc8_table_init(table, p);
+        crc_sweep(s, "crc8", table, 0, p);
+    }
 }
 
-static void scan_algos(void)
+static void crc4_sweep(struct scan const *s, unsigned lo, unsigned hi)
+{
+    uint8_t table[256];
+    for (unsigned p = lo ? lo : 1; p < hi; ++p) {
+        crc8_table_init(table, p << 4);
+        crc_sweep(s, "crc4", table, 4, p);
+    }
+}
+
+/*
+The scans run as tasks on the thread pool: every window, every algorithm,
+and parts of the range of the larger scans (polynomials, shifts).
+For the sweep every start offset of the data window is a window of its own.
+Each transform of the messages is a batch of tasks, all batches run on the same pool.
+Each task prints to its own buffer, the buffers are printed in task order after the batch ran,
+so the output is the same as a sequential run.
+*/
+
+struct algo {
+    char const *name;
+    void (*scan)(struct scan const *s, unsigned lo, unsigned hi);
+    unsigned range; // scan values lo to hi in 0 to range
+    unsigned parts; // split the range into this many tasks
+};
+
+static struct algo const algos[] = {
+        {"byte_sums", byte_sums, 1, 1},
+        {"nibble_sums", nibble_sums, 1, 1},
+        {"crc8_scan", crc8_scan, 256, 8},
+        {"crc4_scan", crc4_scan, 16, 1},
+        {"xor_shift", xor_shift, 128, 32},
+};
+
+// xor_shift is left out, its 16384 shift pairs for every window would take too long
+static struct algo const sweep_algos[] = {
+        {"sums_sweep", sums_sweep, 1, 1},
+        {"crc8_sweep", crc8_sweep, 256, 8},
+        {"crc4_sweep", crc4_sweep, 16, 1},
+};
+
+#define ALGO_COUNT (sizeof(algos) / sizeof(*algos))
+#define SWEEP_ALGO_COUNT (sizeof(sweep_algos) / sizeof(*sweep_algos))
+#define WINDOW_COUNT 3
+
+static int sweep;
+static struct algo const *scan_algos = algos;
+static unsigned scan_algo_count = ALGO_COUNT;
+
+// timing of each algorithm, summed over all its tasks and printed after the findings
+static struct measure_tiles algo_timing[ALGO_COUNT];
+static int window_count = WINDOW_COUNT;
+
+static char const *window_labels[WINDOW_COUNT] = {
+        "Complete message...",
+        "Skipping first byte...",
+        "Omitting last byte...",
+};
+
+static void scan_window(int window, unsigned *off, unsigned *len, unsigned *chk)
 {
-    fprintf(stderr, "Complete message...\n");
-    run_algos(0, msg_len - 1, msg_len - 1);
+    if (window == 0) { // complete message
+        *off = 0; *len = msg_len - 1; *chk = msg_len - 1;
+    }
+    else if (window == 1) { // skipping first byte
+        *off = 1; *len = msg_len - 2; *chk = msg_len - 1;
+    }
+    else { // omitting last byte
+        *off = 0; *len = msg_len - 2; *chk = msg_len - 2;
+    }
+}
+
+struct task_out {
+    char *buf;
+    size_t len;
+};
 
-    fprintf(stderr, "Skipping first byte...\n");
-    run_algos(1, msg_len - 2, msg_len - 1);
+static struct task_out *task_outs;
 
-    fprintf(stderr, "Omitting last byte...\n");
-    run_algos(0, msg_len - 2, msg_len - 2);
+static int tasks_per_window(void)
+{
+    int count = 0;
+    for (unsigned a = 0; a < scan_algo_count; ++a)
+        count += scan_algos[a].parts;
+    return count;
+}
+
+static int job_total(void)
+{
+    return window_count * tasks_per_window();
+}
+
+/// Run one task of the transform @p ctx points to.
+static void job_run(void *ctx, int job_num)
+{
+    int transform  = *(int const *)ctx;
+    int per_window = tasks_per_window();
+    int window     = job_num / per_window;
+    unsigned part  = job_num % per_window;
+    unsigned a     = 0;
+    while (part >= scan_algos[a].parts)
+        part -= scan_algos[a++].parts;
+
+    struct task_out *to = &task_outs[job_num];
+    struct scan s = {open_memstream(&to->buf, &to->len), msgs[transform].d, 0, 0, 0};
+    if (!s.out) {
+        perror("job_run open_memstream");
+        exit(1);
+    }
+    if (sweep)
+        s.off = window; // the sweep tries all lengths and checksum positions
+    else
+        scan_window(window, &s.off, &s.len, &s.chk);
+
+    unsigned lo = part * scan_algos[a].range / scan_algos[a].parts;
+    unsigned hi = (part + 1) * scan_algos[a].range / scan_algos[a].parts;
+    MEASURE_TILES_AT(&algo_timing[a], 0, scan_algos[a].name, scan_algos[a].scan(&s, lo, hi));
+    fclose(s.out);
+}
+
+/// Print the task buffers of a transform in order, with the labels of the sequential scan.
+static void print_tasks(int transform)
+{
+    int per_window = tasks_per_window();
+    fprintf(stderr, "%s\n", transform_labels[transform]);
+    for (int job = 0; job < job_total(); ++job) {
+        int window = job / per_window;
+        if (job % per_window == 0 && sweep)
+            fprintf(stderr, "Windows from byte %d...\n", window);
+        else if (job % per_window == 0)
+            fprintf(stderr, "%s\n", window_labels[window]);
+        fflush(stderr);
+        fwrite(task_outs[job].buf, 1, task_outs[job].len, stdout);
+        fflush(stdout);
+        free(task_outs[job].buf);
+    }
+}
+
+/// Run a batch of @p count jobs on the pool, or in this thread if there is none.
+static void run_batch(struct job_pool *pool, job_fn call, void *ctx, int count)
+{
+    if (pool)
+        job_pool_run(pool, call, ctx, count, 1);
+    else
+        job_exec_sequential(call, ctx, count);
 }
 
 __attribute__((noreturn))
 static void usage(int argc, char const *argv[])
 {
     (void)argc;
-    fprintf(stderr, "%s: codes.txt\n", argv[0]);
+    fprintf(stderr, "%s: [-v] [-a] [-s|-p [threads] [--pin]] codes.txt\n", argv[0]);
     exit(1);
 }
 
@@ -354,16 +687,32 @@ int main(int argc, char const *argv[])
     start_runtimes();
 
     int verbose = 0;
+    int parallel = 1;
+    int threads  = 0;
+    int pin      = 0;
     double min_matches_pct = 0.5;
 
     int i = 1;
     for (; i < argc; ++i) {
         if (*argv[i] != '-')
             break;
-        if (argv[i][1] == 'h')
+        if (!strcmp(argv[i], "--pin"))
+            pin = 1;
+        else if (argv[i][1] == 'h')
             usage(argc, argv);
         else if (argv[i][1] == 'v')
             verbose++;
+        else if (argv[i][1] == 'a')
+            sweep = 1;
+        else if (argv[i][1] == 's')
+            parallel = 0;
+        else if (argv[i][1] == 'p') {
+            parallel = 1;
+            if (argv[i][2])
+                threads = atoi(&argv[i][2]);
+            else if (i + 2 < argc && *argv[i + 1] >= '0' && *argv[i + 1] <= '9')
+                threads = atoi(argv[++i]);
+        }
         else {
             fprintf(stderr, "Wrong argument (%s).\n", argv[i]);
             usage(argc, argv);
@@ -386,30 +735,55 @@ int main(int argc, char const *argv[])
         print_codes(data, msg_len, list_len);
 
     min_matches = list_len * min_matches_pct;
+    for (int t = 0; t < TRANSFORM_COUNT; ++t) {
+        if (msg_matrix_init(&msgs[t], data, msg_len, list_len) < 0)
+            exit(1);
+    }
+    for (unsigned j = 0; j < list_len; ++j) {
+        invert_bytes(msgs[TRANSFORM_INVERT].d[j], msg_len);
+        reflect_bytes(msgs[TRANSFORM_REFLECT].d[j], msg_len);
+        invert_bytes(msgs[TRANSFORM_INVERT_REFLECT].d[j], msg_len);
+        reflect_bytes(msgs[TRANSFORM_INVERT_REFLECT].d[j], msg_len);
+    }
 
     row_weight();
 
-    fprintf(stderr, "Processing...\n");
-    scan_algos();
-
-    fprintf(stderr, "INVERT Inverting...\n");
-    for (unsigned j = 0; j < list_len; ++j) {
-        invert_bytes(data[j].d, msg_len);
+    // one pool for all batches, a null pool runs them in this thread
+    struct job_pool *pool = NULL;
+    if (parallel) {
+        pool = job_pool_create(threads, pin);
+        fprintf(stderr, "Running %d threads...\n", pool->threads);
     }
-    scan_algos();
 
-    fprintf(stderr, "BYTE_REFLECT Reflecting...\n");
-    for (unsigned j = 0; j < list_len; ++j) {
-        invert_bytes(data[j].d, msg_len);
-        reflect_bytes(data[j].d, msg_len);
+    if (sweep) {
+        run_batch(pool, sweep_init, NULL, msg_len);
+        scan_algos      = sweep_algos;
+        scan_algo_count = SWEEP_ALGO_COUNT;
+        window_count    = msg_len;
     }
-    scan_algos();
 
-    fprintf(stderr, "INVERT BYTE_REFLECT Inverting...\n");
-    for (unsigned j = 0; j < list_len; ++j) {
-        invert_bytes(data[j].d, msg_len);
+    for (unsigned a = 0; a < scan_algo_count; ++a)
+        measure_tiles_init(&algo_timing[a], 0, scan_algos[a].name);
+
+    task_outs = calloc(job_total(), sizeof(*task_outs));
+    if (!task_outs) {
+        perror("main calloc");
+        exit(1);
+    }
+    for (int t = 0; t < TRANSFORM_COUNT; ++t) {
+        run_batch(pool, job_run, &t, job_total());
+        print_tasks(t);
     }
-    scan_algos();
+    free(task_outs);
+    if (pool)
+        job_pool_destroy(pool);
+#ifndef INSTRUMENT
+    if (verbose)
+#endif
+        measure_tiles_flush(); // the time of each scan
+
+    for (int t = 0; t < TRANSFORM_COUNT; ++t)
+        msg_matrix_free(&msgs[t]);
 
     print_runtimes();
 }
@@ -162,3 +162,194 @@ static inline uint8_t crc4(uint8_t const message[], unsigned nBytes, uint8_t pol
     }
     return remainder >> 4 & 0x0f; // discard the LSBs
 }
+
+/*
+Table driven CRCs, the bitwise versions above are the reference implementation.
+
+A CRC is linear in the message bits, so a table entry is the XOR of the entries of its set bits.
+Building a table from the eight single bit entries takes 256 XORs, about the cost of running
+the bitwise CRC over four bytes, so tables are cheap enough to build per polynomial.
+
+The slice-by-4/8 tables additionally hold the CRC of a byte followed by 1..7 zero bytes,
+so that 4 or 8 message bytes are folded in with independent lookups.
+*/
+
+/// Build the table for an MSB-first 8-bit CRC. For crc4 use the polynomial shifted up by 4.
+static inline void crc8_table_init(uint8_t table[256], uint8_t polynomial)
+{
+    // the entry for 0x01 is the polynomial, each higher bit is one more shift
+    uint8_t remainder = polynomial;
+    table[0] = 0;
+    table[1] = remainder;
+    for (unsigned bit = 1; bit < 8; ++bit) {
+        remainder = (remainder & 0x80) ? (uint8_t)(remainder << 1) ^ polynomial : (uint8_t)(remainder << 1);
+        table[1 << bit] = remainder;
+    }
+    for (unsigned i = 3; i < 256; ++i) {
+        unsigned low = i & -i;
+        table[i] = table[low] ^ table[i ^ low];
+    }
+}
+
+/// Build the slice-by-8 tables for an MSB-first 8-bit CRC, table[0] is the plain byte table.
+static inline void crc8_slice_init(uint8_t table[8][256], uint8_t polynomial)
+{
+    crc8_table_init(table[0], polynomial);
+    for (unsigned k = 1; k < 8; ++k) {
+        for (unsigned i = 0; i < 256; ++i) {
+            table[k][i] = table[0][table[k - 1][i]];
+        }
+    }
+}
+
+__attribute__((always_inline))
+static inline uint8_t crc8_table(uint8_t const message[], unsigned nBytes, uint8_t const table[256], uint8_t init)
+{
+    uint8_t remainder = init;
+    for (unsigned byte = 0; byte < nBytes; ++byte) {
+        remainder = table[remainder ^ message[byte]];
+    }
+    return remainder;
+}
+
+__attribute__((always_inline))
+static inline uint8_t crc8_slice4(uint8_t const message[], unsigned nBytes, uint8_t table[8][256], uint8_t init)
+{
+    uint8_t remainder = init;
+    for (; nBytes >= 4; nBytes -= 4, message += 4) {
+        remainder = table[3][remainder ^ message[0]]
+                ^ table[2][message[1]]
+                ^ table[1][message[2]]
+                ^ table[0][message[3]];
+    }
+    return crc8_table(message, nBytes, table[0], remainder);
+}
+
+__attribute__((always_inline))
+static inline uint8_t crc8_slice8(uint8_t const message[], unsigned nBytes, uint8_t table[8][256], uint8_t init)
+{
+    uint8_t remainder = init;
+    for (; nBytes >= 8; nBytes -= 8, message += 8) {
+        remainder = table[7][remainder ^ message[0]]
+                ^ table[6][message[1]]
+                ^ table[5][message[2]]
+                ^ table[4][message[3]]
+                ^ table[3][message[4]]
+                ^ table[2][message[5]]
+                ^ table[1][message[6]]
+                ^ table[0][message[7]];
+    }
+    return crc8_slice4(message, nBytes, table, remainder);
+}
+
+/// Table driven crc4, the table is built with crc8_table_init(table, polynomial << 4).
+__attribute__((always_inline))
+static inline uint8_t crc4_table(uint8_t const message[], unsigned nBytes, uint8_t const table[256], uint8_t init)
+{
+    return crc8_table(message, nBytes, table, init << 4) >> 4; // LSBs stay zero
+}
+
+/// Build the table for an MSB-first 16-bit CRC.
+static inline void crc16_table_init(uint16_t table[256], uint16_t polynomial)
+{
+    // the entry for 0x01 is 0x0100 shifted 8 times, each higher bit is one more shift
+    uint16_t remainder = 0x0100;
+    for (unsigned bit = 0; bit < 8; ++bit) {
+        remainder = (remainder & 0x8000) ? (uint16_t)(remainder << 1) ^ polynomial : (uint16_t)(remainder << 1);
+    }
+    table[0] = 0;
+    table[1] = remainder;
+    for (unsigned bit = 1; bit < 8; ++bit) {
+        remainder = (remainder & 0x8000) ? (uint16_t)(remainder << 1) ^ polynomial : (uint16_t)(remainder << 1);
+        table[1 << bit] = remainder;
+    }
+    for (unsigned i = 3; i < 256; ++i) {
+        unsigned low = i & -i;
+        table[i] = table[low] ^ table[i ^ low];
+    }
+}
+
+/// Build the slice-by-4 tables for an MSB-first 16-bit CRC, table[0] is the plain byte table.
+static inline void crc16_slice_init(uint16_t table[4][256], uint16_t polynomial)
+{
+    crc16_table_init(table[0], polynomial);
+    for (unsigned k = 1; k < 4; ++k) {
+        for (unsigned i = 0; i < 256; ++i) {
+            table[k][i] = (uint16_t)(table[k - 1][i] << 8) ^ table[0][table[k - 1][i] >> 8];
+        }
+    }
+}
+
+__attribute__((always_inline))
+static inline uint16_t crc16_table(uint8_t const message[], unsigned nBytes, uint16_t const table[256], uint16_t init)
+{
+    uint16_t remainder = init;
+    for (unsigned byte = 0; byte < nBytes; ++byte) {
+        remainder = (uint16_t)(remainder << 8) ^ table[(remainder >> 8) ^ message[byte]];
+    }
+    return remainder;
+}
+
+__attribute__((always_inline))
+static inline uint16_t crc16_slice4(uint8_t const message[], unsigned nBytes, uint16_t table[4][256], uint16_t init)
+{
+    uint16_t remainder = init;
+    for (; nBytes >= 4; nBytes -= 4, message += 4) {
+        remainder = table[3][(remainder >> 8) ^ message[0]]
+                ^ table[2][(remainder & 0xff) ^ message[1]]
+                ^ table[1][message[2]]
+                ^ table[0][message[3]];
+    }
+    return crc16_table(message, nBytes, table[0], remainder);
+}
+
+/// Build the table for a reflected (LSB-first) 16-bit CRC, the polynomial is given reflected.
+static inline void crc16lsb_table_init(uint16_t table[256], uint16_t polynomial)
+{
+    // the entry for 0x80 is the polynomial, each lower bit is one more shift
+    uint16_t remainder = polynomial;
+    table[0]    = 0;
+    table[0x80] = remainder;
+    for (unsigned bit = 1; bit < 8; ++bit) {
+        remainder = (remainder & 1) ? (remainder >> 1) ^ polynomial : (remainder >> 1);
+        table[0x80 >> bit] = remainder;
+    }
+    for (unsigned i = 3; i < 256; ++i) {
+        unsigned low = i & -i;
+        table[i] = table[low] ^ table[i ^ low];
+    }
+}
+
+/// Build the slice-by-4 tables for a reflected 16-bit CRC, table[0] is the plain byte table.
+static inline void crc16lsb_slice_init(uint16_t table[4][256], uint16_t polynomial)
+{
+    crc16lsb_table_init(table[0], polynomial);
+    for (unsigned k = 1; k < 4; ++k) {
+        for (unsigned i = 0; i < 256; ++i) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+        }
+    }
+}
+
+__attribute__((always_inline))
+static inline uint16_t crc16lsb_table(uint8_t const message[], unsigned nBytes, uint16_t const table[256], uint16_t init)
+{
+    uint16_t remainder = init;
+    for (unsigned byte = 0; byte < nBytes; ++byte) {
+        remainder = (remainder >> 8) ^ table[(remainder ^ message[byte]) & 0xff];
+    }
+    return remainder;
+}
+
+__attribute__((always_inline))
+static inline uint16_t crc16lsb_slice4(uint8_t const message[], unsigned nBytes, uint16_t table[4][256], uint16_t init)
+{
+    uint16_t remainder = init;
+    for (; nBytes >= 4; nBytes -= 4, message += 4) {
+        remainder = table[3][(remainder & 0xff) ^ message[0]]
+                ^ table[2][(remainder >> 8) ^ message[1]]
+                ^ table[1][message[2]]
+                ^ table[0][message[3]];
+    }
+    return crc16lsb_table(message, nBytes, table[0], remainder);
+}